@@ -436,6 +436,9 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
      ((y + 8 * size - 1) < 0))   // Clip top
     return;
 
+  if ((size == 1) && drawCharColumns(x, y, font+(c*5), color, bg))
+    return;
+
   for (int8_t i=0; i<6; i++ ) {
     uint8_t line;
     if (i == 5) 
@@ -518,3 +521,9 @@ void Adafruit_GFX::invertDisplay(boolean i) {
   // Do nothing, must be subclassed if supported
 }
 
+boolean Adafruit_GFX::drawCharColumns(int16_t x, int16_t y,
+				      const uint8_t *glyph, uint16_t color, uint16_t bg) {
+  // No fast path, must be subclassed if supported
+  return false;
+}
+
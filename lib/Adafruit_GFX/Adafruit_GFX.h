@@ -19,6 +19,12 @@ class Adafruit_GFX : public Print {
   // This MUST be defined by the subclass:
   virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
 
+  // May be overridden by framebuffer displays to copy the 5 glyph columns
+  // (in PROGMEM, LSB on top) of a size 1 character in one go.
+  // Return false to fall back to the per-pixel drawChar().
+  virtual boolean drawCharColumns(int16_t x, int16_t y, const uint8_t *glyph,
+    uint16_t color, uint16_t bg);
+
   // These MAY be overridden by the subclass to provide device-specific
   // optimized code.  Otherwise 'generic' versions are used.
   virtual void
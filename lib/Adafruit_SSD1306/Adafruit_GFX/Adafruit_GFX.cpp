@@ -720,6 +720,9 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
 
         if(!_cp437 && (c >= 176)) c++; // Handle 'classic' charset behavior
 
+        if((size == 1) && drawCharColumns(x, y, &font[c * 5], color, bg))
+            return;
+
         startWrite();
         for(int8_t i=0; i<5; i++ ) { // Char bitmap = 5 columns
             uint8_t line = pgm_read_byte(&font[c * 5 + i]);
@@ -1056,6 +1059,12 @@ void Adafruit_GFX::invertDisplay(boolean i) {
     // Do nothing, must be subclassed if supported by hardware
 }
 
+boolean Adafruit_GFX::drawCharColumns(int16_t x, int16_t y,
+  const uint8_t *glyph, uint16_t color, uint16_t bg) {
+    // No fast path, must be subclassed if supported by hardware
+    return false;
+}
+
 /***************************************************************************/
 // code for the GFX button UI element
 
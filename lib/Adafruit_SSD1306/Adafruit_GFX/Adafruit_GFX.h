@@ -35,6 +35,13 @@ class Adafruit_GFX : public Print {
   virtual void setRotation(uint8_t r);
   virtual void invertDisplay(boolean i);
 
+  // CLASSIC FONT FAST PATH
+  // MAY be overridden by framebuffer displays to copy the 5 glyph columns
+  // (in PROGMEM, LSB on top) of a size 1 'classic' character in one go.
+  // Return false to fall back to the per-pixel drawChar().
+  virtual boolean drawCharColumns(int16_t x, int16_t y, const uint8_t *glyph,
+    uint16_t color, uint16_t bg);
+
   // BASIC DRAW API
   // These MAY be overridden by the subclass to provide device-specific
   // optimized code.  Otherwise 'generic' versions are used.
@@ -34,6 +34,7 @@ All text above, and the splash screen below must be included in any redistributi
 #include <SPI.h>
 #include "Adafruit_GFX.h"
 #include "Adafruit_SSD1306.h"
+#include "SSD1306_TWI.h"
 
 // the memory buffer for the LCD
 
@@ -110,6 +111,31 @@ static uint8_t buffer[SSD1306_LCDHEIGHT * SSD1306_LCDWIDTH / 8] = {
 
 #define ssd1306_swap(a, b) { int16_t t = a; a = b; b = t; }
 
+#define SSD1306_PAGES (SSD1306_LCDHEIGHT / 8)
+
+// dirty column span of every page, [dirtyStart, dirtyEnd]
+// a page is clean when dirtyStart > dirtyEnd
+static uint8_t dirtyStart[SSD1306_PAGES];
+static uint8_t dirtyEnd[SSD1306_PAGES];
+
+static inline void ssd1306_markDirty(uint8_t page, uint8_t x0, uint8_t x1) {
+  if (x0 < dirtyStart[page]) dirtyStart[page] = x0;
+  if (x1 > dirtyEnd[page])   dirtyEnd[page]   = x1;
+}
+
+static inline void ssd1306_markClean(uint8_t page) {
+  dirtyStart[page] = 0xFF;
+  dirtyEnd[page]   = 0;
+}
+
+// mark the pages of a window clean, returns its size in bytes
+static uint16_t ssd1306_markWindowClean(const SSD1306_TWIWindow *w) {
+  for (uint8_t page=w->page0; page<=w->page1; page++) {
+    ssd1306_markClean(page);
+  }
+  return (uint16_t)(w->page1 - w->page0 + 1) * (w->col1 - w->col0 + 1);
+}
+
 // the most basic function, set a single pixel
 void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
   if ((x < 0) || (x >= width()) || (y < 0) || (y >= height()))
@@ -131,6 +157,8 @@ void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
     break;
   }
 
+  ssd1306_markDirty(y/8, x, x);
+
   // x is which column
     switch (color)
     {
@@ -141,6 +169,57 @@ void Adafruit_SSD1306::drawPixel(int16_t x, int16_t y, uint16_t color) {
 
 }
 
+// apply one glyph byte to a framebuffer byte, bits set in mask are drawn
+// with color and the rest of mask (the glyph background) with bg
+static inline void ssd1306_blitByte(uint8_t *pBuf, uint8_t bits, uint8_t mask,
+                                    uint16_t color, uint16_t bg) {
+  switch (color) {
+    case WHITE:   *pBuf |=  bits; break;
+    case BLACK:   *pBuf &= ~bits; break;
+    case INVERSE: *pBuf ^=  bits; break;
+  }
+  if (bg != color) {
+    bits = mask & ~bits;
+    switch (bg) {
+      case WHITE:   *pBuf |=  bits; break;
+      case BLACK:   *pBuf &= ~bits; break;
+      case INVERSE: *pBuf ^=  bits; break;
+    }
+  }
+}
+
+// Classic font fast path: with no rotation a glyph column is one framebuffer
+// byte when y is a multiple of 8, and two shifted bytes otherwise. Characters
+// that are partly off screen go through the generic drawChar().
+boolean Adafruit_SSD1306::drawCharColumns(int16_t x, int16_t y, const uint8_t *glyph,
+                                          uint16_t color, uint16_t bg) {
+  if ((getRotation() != 0) ||
+      (x < 0) || (x > SSD1306_LCDWIDTH - 6) ||
+      (y < 0) || (y > SSD1306_LCDHEIGHT - 8))
+    return false;
+
+  register uint8_t *pBuf = buffer + (y/8) * SSD1306_LCDWIDTH + x;
+  register uint8_t shift = y & 7;
+  uint8_t columns = (bg != color) ? 6 : 5;    // opaque text also clears the gap
+
+  ssd1306_markDirty(y/8, x, x+columns-1);
+  if (shift) {
+    ssd1306_markDirty(y/8 + 1, x, x+columns-1);
+  }
+
+  for (uint8_t i=0; i<columns; i++, pBuf++) {
+    uint8_t line = (i < 5) ? pgm_read_byte(glyph + i) : 0;
+
+    if (!shift) {
+      ssd1306_blitByte(pBuf, line, 0xFF, color, bg);
+    } else {
+      ssd1306_blitByte(pBuf, line << shift, 0xFF << shift, color, bg);
+      ssd1306_blitByte(pBuf + SSD1306_LCDWIDTH, line >> (8-shift), 0xFF >> (8-shift), color, bg);
+    }
+  }
+  return true;
+}
+
 Adafruit_SSD1306::Adafruit_SSD1306(int8_t SID, int8_t SCLK, int8_t DC, int8_t RST, int8_t CS) : Adafruit_GFX(SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT) {
   cs = CS;
   rst = RST;
@@ -148,6 +227,10 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t SID, int8_t SCLK, int8_t DC, int8_t RS
   sclk = SCLK;
   sid = SID;
   hwSPI = false;
+  _transferBuffer = NULL;
+  _i2cClock = 400000L;
+  _i2cTransport = SSD1306_I2C_DEFAULT;
+  _displayCallback = NULL;
 }
 
 // constructor for hardware SPI - we indicate DataCommand, ChipSelect, Reset
@@ -156,6 +239,10 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t DC, int8_t RST, int8_t CS) : Adafruit_
   rst = RST;
   cs = CS;
   hwSPI = true;
+  _transferBuffer = NULL;
+  _i2cClock = 400000L;
+  _i2cTransport = SSD1306_I2C_DEFAULT;
+  _displayCallback = NULL;
 }
 
 // initializer for I2C - we only indicate the reset pin!
@@ -163,12 +250,22 @@ Adafruit_SSD1306::Adafruit_SSD1306(int8_t reset) :
 Adafruit_GFX(SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT) {
   sclk = dc = cs = sid = -1;
   rst = reset;
+  _transferBuffer = NULL;
+  _i2cClock = 400000L;
+  _i2cTransport = SSD1306_I2C_DEFAULT;
+  _displayCallback = NULL;
 }
 
 
 void Adafruit_SSD1306::begin(uint8_t vccstate, uint8_t i2caddr, bool reset) {
   _vccstate = vccstate;
   _i2caddr = i2caddr;
+  _frameBytes = 0;
+
+  // the panel RAM is unknown after reset, the first display() sends everything
+  for (uint8_t page=0; page<SSD1306_PAGES; page++) {
+    ssd1306_markDirty(page, 0, SSD1306_LCDWIDTH-1);
+  }
 
   // set pin directions
   if (sid != -1){
@@ -203,7 +300,11 @@ void Adafruit_SSD1306::begin(uint8_t vccstate, uint8_t i2caddr, bool reset) {
   else
   {
     // I2C Init
+#ifdef SSD1306_TWI_ASYNC
+    SSD1306_TWI::begin(_i2cClock);
+#else
     Wire.begin();
+#endif
 #ifdef __SAM3X8E__
     // Force 400 KHz I2C, rawr! (Uses pins 20, 21 for SDA, SCL)
     TWI1->TWI_CWGR = 0;
@@ -319,11 +420,21 @@ void Adafruit_SSD1306::ssd1306_command(uint8_t c) {
   else
   {
     // I2C
+#ifdef SSD1306_TWI_ASYNC
+    SSD1306_TWI::writeCommands(_i2caddr, &c, 1);
+#else
+#ifdef SSD1306_HAVE_TWI
+    if (_i2cTransport == SSD1306_I2C_DIRECT) {
+      SSD1306_TWI::writeCommands(_i2caddr, &c, 1);
+      return;
+    }
+#endif
     uint8_t control = 0x00;   // Co = 0, D/C = 0
     Wire.beginTransmission(_i2caddr);
     Wire.write(control);
     Wire.write(c);
     Wire.endTransmission();
+#endif
   }
 }
 
@@ -416,22 +527,117 @@ void Adafruit_SSD1306::dim(boolean dim) {
   ssd1306_command(contrast);
 }
 
+// Send the dirty parts of the buffer to the display.
+// Consecutive dirty pages are merged into a single COLUMNADDR/PAGEADDR window
+// when the extra bytes are cheaper than addressing a new window.
+// With SSD1306_TWI_ASYNC the I2C transfer runs from the TWI interrupt and
+// display() returns as soon as it has started, see isBusy().
 void Adafruit_SSD1306::display(void) {
+  SSD1306_TWIWindow windows[SSD1306_PAGES];
+  uint8_t count = SSD1306_dirtyWindows(dirtyStart, dirtyEnd, SSD1306_PAGES, windows);
+
+  _frameBytes = 0;
+
+#ifdef SSD1306_TWI_ASYNC
+  if (sid == -1) {
+    const uint8_t *src = buffer;
+
+    // the transfer buffer may still be on the wire
+    SSD1306_TWI::waitIdle();
+
+    for (uint8_t i=0; i<count; i++) {
+      const SSD1306_TWIWindow *w = &windows[i];
+
+      if (_transferBuffer) {
+        for (uint8_t page=w->page0; page<=w->page1; page++) {
+          uint16_t offset = page*SSD1306_LCDWIDTH + w->col0;
+          memcpy(_transferBuffer + offset, buffer + offset, w->col1 - w->col0 + 1);
+        }
+      }
+      _frameBytes += ssd1306_markWindowClean(w);
+    }
+    if (_transferBuffer) {
+      src = _transferBuffer;
+    }
+
+    if (!count) {
+      // nothing dirty, no transfer to complete: done now, as without SSD1306_TWI_ASYNC
+      if (_displayCallback) {
+        _displayCallback();
+      }
+      return;
+    }
+    SSD1306_TWI::onComplete(_displayCallback);
+    SSD1306_TWI::writeWindows(_i2caddr, src, SSD1306_LCDWIDTH, windows, count);
+    return;
+  }
+#elif defined(SSD1306_HAVE_TWI)
+  if (sid == -1) {
+    // save I2C bitrate
+    uint8_t twbrbackup = TWBR;
+    SSD1306_TWI::setClock(_i2cClock);
+
+    if (_i2cTransport == SSD1306_I2C_DIRECT) {
+      SSD1306_TWI::writeWindowsPolled(_i2caddr, buffer, SSD1306_LCDWIDTH, windows, count);
+      for (uint8_t i=0; i<count; i++) {
+        _frameBytes += ssd1306_markWindowClean(&windows[i]);
+      }
+    } else {
+      for (uint8_t i=0; i<count; i++) {
+        displayWindow(windows[i].page0, windows[i].page1, windows[i].col0, windows[i].col1);
+      }
+    }
+
+    TWBR = twbrbackup;
+    if (_displayCallback) {
+      _displayCallback();
+    }
+    return;
+  }
+#endif
+
+  for (uint8_t i=0; i<count; i++) {
+    displayWindow(windows[i].page0, windows[i].page1, windows[i].col0, windows[i].col1);
+  }
+  if (_displayCallback) {
+    _displayCallback();
+  }
+}
+
+// true while display() is still sending the framebuffer
+boolean Adafruit_SSD1306::isBusy(void) {
+#ifdef SSD1306_TWI_ASYNC
+  if (sid == -1) {
+    return SSD1306_TWI::isBusy();
+  }
+#endif
+  return false;
+}
+
+// Function called when a display() transfer ends.
+// With SSD1306_TWI_ASYNC it runs inside the TWI interrupt, keep it short
+// (or from display() itself when nothing was dirty).
+void Adafruit_SSD1306::setDisplayCallback(void (*callback)(void)) {
+  _displayCallback = callback;
+}
+
+// Optional second framebuffer (SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8 bytes).
+// display() copies the dirty windows into it and streams from there, so the
+// next frame can be drawn while the current one is being sent.
+// Without it, drawing before isBusy() turns false may tear the frame.
+void Adafruit_SSD1306::setTransferBuffer(uint8_t *transferBuffer) {
+  _transferBuffer = transferBuffer;
+}
+
+// Send pages [page0, page1] x columns [col0, col1] of the buffer and mark them clean
+void Adafruit_SSD1306::displayWindow(uint8_t page0, uint8_t page1, uint8_t col0, uint8_t col1) {
   ssd1306_command(SSD1306_COLUMNADDR);
-  ssd1306_command(0);   // Column start address (0 = reset)
-  ssd1306_command(SSD1306_LCDWIDTH-1); // Column end address (127 = reset)
+  ssd1306_command(col0);  // Column start address
+  ssd1306_command(col1);  // Column end address
 
   ssd1306_command(SSD1306_PAGEADDR);
-  ssd1306_command(0); // Page start address (0 = reset)
-  #if SSD1306_LCDHEIGHT == 64
-    ssd1306_command(7); // Page end address
-  #endif
-  #if SSD1306_LCDHEIGHT == 32
-    ssd1306_command(3); // Page end address
-  #endif
-  #if SSD1306_LCDHEIGHT == 16
-    ssd1306_command(1); // Page end address
-  #endif
+  ssd1306_command(page0); // Page start address
+  ssd1306_command(page1); // Page end address
 
   if (sid != -1)
   {
@@ -446,8 +652,11 @@ void Adafruit_SSD1306::display(void) {
     digitalWrite(cs, LOW);
 #endif
 
-    for (uint16_t i=0; i<(SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8); i++) {
-      fastSPIwrite(buffer[i]);
+    for (uint8_t page=page0; page<=page1; page++) {
+      uint8_t *pBuf = buffer + page*SSD1306_LCDWIDTH + col0;
+      for (uint8_t x=col0; x<=col1; x++) {
+        fastSPIwrite(*pBuf++);
+      }
     }
 #ifdef HAVE_PORTREG
     *csport |= cspinmask;
@@ -455,37 +664,68 @@ void Adafruit_SSD1306::display(void) {
     digitalWrite(cs, HIGH);
 #endif
   }
+#ifndef SSD1306_TWI_ASYNC
   else
   {
-    // save I2C bitrate
-#ifdef TWBR
-    uint8_t twbrbackup = TWBR;
-    TWBR = 12; // upgrade to 400KHz!
-#endif
-
-    //Serial.println(TWBR, DEC);
-    //Serial.println(TWSR & 0x3, DEC);
-
-    // I2C
-    for (uint16_t i=0; i<(SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8); i++) {
-      // send a bunch of data in one xmission
-      Wire.beginTransmission(_i2caddr);
-      WIRE_WRITE(0x40);
-      for (uint8_t x=0; x<16; x++) {
-        WIRE_WRITE(buffer[i]);
-        i++;
+    // I2C, send a bunch of data in one xmission (Wire buffers 32 bytes)
+    uint8_t chunk = 0;
+    for (uint8_t page=page0; page<=page1; page++) {
+      uint8_t *pBuf = buffer + page*SSD1306_LCDWIDTH + col0;
+      for (uint8_t x=col0; x<=col1; x++) {
+        if (!chunk) {
+          Wire.beginTransmission(_i2caddr);
+          WIRE_WRITE(0x40);
+        }
+        WIRE_WRITE(*pBuf++);
+        if (++chunk == 16) {
+          Wire.endTransmission();
+          chunk = 0;
+        }
       }
-      i--;
+    }
+    if (chunk) {
       Wire.endTransmission();
     }
-#ifdef TWBR
-    TWBR = twbrbackup;
-#endif
   }
+#endif
+
+  SSD1306_TWIWindow w = { page0, page1, col0, col1 };
+  _frameBytes += ssd1306_markWindowClean(&w);
+}
+
+// I2C clock used while sending the framebuffer (default 400 kHz).
+// 800000 and 1000000 are out of spec but usually work, see SSD1306_TWI.h
+void Adafruit_SSD1306::setI2CClock(uint32_t clock) {
+  _i2cClock = clock;
+#ifdef SSD1306_TWI_ASYNC
+  SSD1306_TWI::setClock(clock);
+#endif
+}
+
+// SSD1306_I2C_DIRECT (default on AVR) sends each window as one continuous
+// TWI burst, SSD1306_I2C_WIRE goes through Wire in 16 byte transactions
+void Adafruit_SSD1306::setI2CTransport(uint8_t transport) {
+  _i2cTransport = transport;
+}
+
+// Number of framebuffer bytes sent by the last display() call
+uint16_t Adafruit_SSD1306::getFrameBytes(void) {
+  return _frameBytes;
 }
 
 // clear everything
+// only the columns that were actually lit become dirty
 void Adafruit_SSD1306::clearDisplay(void) {
+  for (uint8_t page=0; page<SSD1306_PAGES; page++) {
+    uint8_t *pBuf = buffer + page*SSD1306_LCDWIDTH;
+    int16_t x0 = 0, x1 = SSD1306_LCDWIDTH-1;
+
+    while (x0 <= x1 && !pBuf[x0]) x0++;
+    while (x1 > x0 && !pBuf[x1]) x1--;
+    if (x0 <= x1) {
+      ssd1306_markDirty(page, x0, x1);
+    }
+  }
   memset(buffer, 0, (SSD1306_LCDWIDTH*SSD1306_LCDHEIGHT/8));
 }
 
@@ -563,6 +803,8 @@ void Adafruit_SSD1306::drawFastHLineInternal(int16_t x, int16_t y, int16_t w, ui
   // if our width is now negative, punt
   if(w <= 0) { return; }
 
+  ssd1306_markDirty(y/8, x, x+w-1);
+
   // set up the pointer for  movement through the buffer
   register uint8_t *pBuf = buffer;
   // adjust the buffer pointer for the current row
@@ -637,6 +879,10 @@ void Adafruit_SSD1306::drawFastVLineInternal(int16_t x, int16_t __y, int16_t __h
     return;
   }
 
+  for (uint8_t page=__y/8; page<=(__y+__h-1)/8; page++) {
+    ssd1306_markDirty(page, x, x);
+  }
+
   // this display doesn't need ints for coordinates, use local byte registers for faster juggling
   register uint8_t y = __y;
   register uint8_t h = __h;
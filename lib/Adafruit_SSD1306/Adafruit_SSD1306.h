@@ -53,6 +53,15 @@ All text above, and the splash screen must be included in any redistribution
 #define INVERSE 2
 
 #define SSD1306_I2C_ADDRESS   0x3C  // 011110+SA0+RW - 0x3C or 0x3D
+
+// I2C transport for display(), see setI2CTransport()
+#define SSD1306_I2C_WIRE      0
+#define SSD1306_I2C_DIRECT    1
+#if defined(__AVR__) && defined(TWCR)
+  #define SSD1306_I2C_DEFAULT SSD1306_I2C_DIRECT
+#else
+  #define SSD1306_I2C_DEFAULT SSD1306_I2C_WIRE
+#endif
 // Address for 128x32 is 0x3C
 // Address for 128x64 is 0x3D (default) or 0x3C (if SA0 is grounded)
 
@@ -69,10 +78,15 @@ All text above, and the splash screen must be included in any redistribution
 
     SSD1306_96_16
 
+    The size can also be given as a build flag (e.g. -D SSD1306_128_32)
+    instead of editing this file. SSD1306_Display<W, H> (SSD1306_Display.h)
+    takes the size as template parameters and does not use these defines.
     -----------------------------------------------------------------------*/
+#if !defined SSD1306_128_64 && !defined SSD1306_128_32 && !defined SSD1306_96_16
    #define SSD1306_128_64
 //   #define SSD1306_128_32
 //   #define SSD1306_96_16
+#endif
 /*=========================================================================*/
 
 #if defined SSD1306_128_64 && defined SSD1306_128_32
@@ -153,6 +167,14 @@ class Adafruit_SSD1306 : public Adafruit_GFX {
   void clearDisplay(void);
   void invertDisplay(uint8_t i);
   void display();
+  uint16_t getFrameBytes(void);
+
+  boolean isBusy(void);
+  void setDisplayCallback(void (*callback)(void));
+  void setTransferBuffer(uint8_t *transferBuffer);
+
+  void setI2CClock(uint32_t clock);
+  void setI2CTransport(uint8_t transport);
 
   void startscrollright(uint8_t start, uint8_t stop);
   void startscrollleft(uint8_t start, uint8_t stop);
@@ -164,13 +186,21 @@ class Adafruit_SSD1306 : public Adafruit_GFX {
   void dim(boolean dim);
 
   void drawPixel(int16_t x, int16_t y, uint16_t color);
+  virtual boolean drawCharColumns(int16_t x, int16_t y, const uint8_t *glyph,
+                                  uint16_t color, uint16_t bg);
 
   virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
   virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
 
  private:
   int8_t _i2caddr, _vccstate, sid, sclk, dc, rst, cs;
+  uint16_t _frameBytes;
+  uint8_t *_transferBuffer;
+  void (*_displayCallback)(void);
+  uint32_t _i2cClock;
+  uint8_t _i2cTransport;
   void fastSPIwrite(uint8_t c);
+  void displayWindow(uint8_t page0, uint8_t page1, uint8_t col0, uint8_t col1);
 
   boolean hwSPI;
 #ifdef HAVE_PORTREG
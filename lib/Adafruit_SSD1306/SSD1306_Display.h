@@ -0,0 +1,415 @@
+/*********************************************************************
+SSD1306 I2C driver with the panel geometry and rotation fixed at compile
+time, for AVR (uses SSD1306_TWI).
+
+  SSD1306_Display<128, 64>     display;     // 128x64, no rotation
+  SSD1306_Display<128, 32, 2>  display;     // 128x32, upside down
+
+Buffer size, page count and the pixel address math are constants, so the
+rotation switch and most bounds math of Adafruit_SSD1306 fold away and one
+codebase can drive different panels without editing Adafruit_SSD1306.h.
+The framebuffer is a member, it lives wherever the object does.
+
+Like Adafruit_SSD1306, only the dirty windows are sent by display(). With
+SSD1306_TWI_ASYNC the transfer runs from the TWI interrupt, see isBusy().
+
+Paged mode: with BUF_PAGES below H/8 only that many 8 pixel pages are kept
+in RAM (128 bytes per page on a 128 wide panel instead of the whole
+framebuffer). drawPages() then clears the band, calls the draw callback,
+which redraws the whole screen, and sends the band, once per band. Drawing
+is clipped to the band held in RAM, so the callback does not need to know
+about it.
+
+  SSD1306_Display<128, 64, 0, 1> display;   // 128 bytes of framebuffer
+  display.drawPages(drawScreen, NULL);
+*********************************************************************/
+#ifndef _SSD1306_DISPLAY_H_
+#define _SSD1306_DISPLAY_H_
+
+#include <Adafruit_GFX.h>
+#include "Adafruit_SSD1306.h"
+#include "SSD1306_TWI.h"
+
+#ifdef SSD1306_HAVE_TWI
+
+// draw callback for paged rendering, context is the pointer given to drawPages()
+typedef void (*SSD1306_DrawCallback)(void *context);
+
+template <uint8_t W, uint8_t H, uint8_t ROT = 0, uint8_t BUF_PAGES = H / 8>
+class SSD1306_Display : public Adafruit_GFX {
+ public:
+  static constexpr uint8_t  PAGES          = H / 8;
+  static constexpr bool     PAGED          = BUF_PAGES < PAGES;
+  static constexpr uint16_t BUFFER_SIZE    = (uint16_t)W * BUF_PAGES;
+  static constexpr int16_t  LOGICAL_WIDTH  = (ROT & 1) ? H : W;
+  static constexpr int16_t  LOGICAL_HEIGHT = (ROT & 1) ? W : H;
+
+  static_assert(W > 0 && W <= 128, "SSD1306 width must be 1..128");
+  static_assert(H >= 8 && H <= 64 && (H % 8) == 0, "SSD1306 height must be 8..64, multiple of 8");
+  static_assert(ROT < 4, "rotation must be 0..3");
+  static_assert(BUF_PAGES > 0 && BUF_PAGES <= H / 8, "BUF_PAGES must be 1..H/8");
+
+  SSD1306_Display(int8_t rst = -1) : Adafruit_GFX(W, H) {
+    Adafruit_GFX::setRotation(ROT);
+    _rst = rst;
+    _frameBytes = 0;
+    _busBytes = 0;
+    _displayCallback = NULL;
+    _i2cClock = 400000L;
+    _page0 = 0;
+    memset(_buffer, 0, BUFFER_SIZE);
+    for (uint8_t page=0; page<PAGES; page++) {
+      markClean(page);                        // the pages outside the band are never sent from _buffer
+    }
+    markAllDirty();
+  }
+
+  void begin(uint8_t vccstate = SSD1306_SWITCHCAPVCC, uint8_t i2caddr = SSD1306_I2C_ADDRESS) {
+    _vccstate = vccstate;
+    _i2caddr = i2caddr;
+
+    SSD1306_TWI::begin(_i2cClock);
+
+    if (_rst >= 0) {
+      pinMode(_rst, OUTPUT);
+      digitalWrite(_rst, HIGH);
+      delay(1);
+      digitalWrite(_rst, LOW);
+      delay(10);
+      digitalWrite(_rst, HIGH);
+    }
+
+    const uint8_t init[] = {
+      SSD1306_DISPLAYOFF,
+      SSD1306_SETDISPLAYCLOCKDIV, 0x80,
+      SSD1306_SETMULTIPLEX, H - 1,
+      SSD1306_SETDISPLAYOFFSET, 0x00,
+      SSD1306_SETSTARTLINE | 0x0,
+      SSD1306_CHARGEPUMP, (uint8_t)((vccstate == SSD1306_EXTERNALVCC) ? 0x10 : 0x14),
+      SSD1306_MEMORYMODE, 0x00,
+      SSD1306_SEGREMAP | 0x1,
+      SSD1306_COMSCANDEC,
+      SSD1306_SETCOMPINS, (uint8_t)((H == 64) ? 0x12 : 0x02),
+      SSD1306_SETCONTRAST, contrast(),
+      SSD1306_SETPRECHARGE, (uint8_t)((vccstate == SSD1306_EXTERNALVCC) ? 0x22 : 0xF1),
+      SSD1306_SETVCOMDETECT, 0x40,
+      SSD1306_DISPLAYALLON_RESUME,
+      SSD1306_NORMALDISPLAY,
+      SSD1306_DEACTIVATE_SCROLL,
+      SSD1306_DISPLAYON
+    };
+    commands(init, sizeof(init));
+  }
+
+  void command(uint8_t c) {
+    commands(&c, 1);
+  }
+
+  // sent in transactions of up to SSD1306_TWI_MAX_COMMANDS bytes
+  void commands(const uint8_t *cmds, uint8_t len) {
+    while (len) {
+      uint8_t n = min(len, (uint8_t)SSD1306_TWI_MAX_COMMANDS);
+
+      SSD1306_TWI::writeCommands(_i2caddr, cmds, n);
+      _busBytes += n + 2;                     // address and control bytes
+      cmds += n;
+      len -= n;
+    }
+  }
+
+  // in paged mode only the band held in RAM can be dirty
+  void display(void) {
+    SSD1306_TWIWindow windows[BUF_PAGES];
+    uint8_t first = page0();
+    uint8_t count = SSD1306_dirtyWindows(_dirtyStart + first, _dirtyEnd + first,
+                                         PAGES - first < BUF_PAGES ? PAGES - first : BUF_PAGES, windows);
+
+    _frameBytes = 0;
+    for (uint8_t i=0; i<count; i++) {
+      SSD1306_TWIWindow *w = &windows[i];
+
+      w->page0 += first;                      // band relative to panel pages
+      w->page1 += first;
+
+      for (uint8_t page=w->page0; page<=w->page1; page++) {
+        markClean(page);
+      }
+      _frameBytes += (uint16_t)(w->page1 - w->page0 + 1) * (w->col1 - w->col0 + 1);
+    }
+    // plus 8 bytes of addressing commands and 2 of data header per window
+    _busBytes += _frameBytes + count * 10;
+
+#ifdef SSD1306_TWI_ASYNC
+    if (!count) {
+      // nothing to send, no transfer will complete
+      if (_displayCallback) {
+        _displayCallback();
+      }
+      return;
+    }
+    SSD1306_TWI::onComplete(_displayCallback);
+    SSD1306_TWI::writeWindows(_i2caddr, _buffer, W, windows, count, page0());
+#else
+    SSD1306_TWI::writeWindowsPolled(_i2caddr, _buffer, W, windows, count, page0());
+    if (_displayCallback) {
+      _displayCallback();
+    }
+#endif
+  }
+
+  // Paged rendering: for every band of BUF_PAGES pages, clear it, call draw
+  // to redraw the whole screen (clipped to the band) and send it. The whole
+  // panel is sent every time, there is no dirty tracking between frames.
+  void drawPages(SSD1306_DrawCallback draw, void *context) {
+    for (uint8_t page=0; page<PAGES; page+=BUF_PAGES) {
+      // the previous band may still be on the wire
+      SSD1306_TWI::waitIdle();
+
+      _page0 = page;
+      memset(_buffer, 0, BUFFER_SIZE);
+      for (uint8_t p=page; p<page+BUF_PAGES && p<PAGES; p++) {
+        markDirty(p, 0, W - 1);
+      }
+      draw(context);
+      display();
+    }
+  }
+
+  // only the pages with lit pixels are sent by the next display()
+  void clearDisplay(void) {
+    uint8_t *pBuf = _buffer;
+
+    for (uint8_t page=page0(); page<page0()+BUF_PAGES && page<PAGES; page++, pBuf += W) {
+      uint8_t x0 = 0, x1 = W - 1;
+
+      while (x0 < W && !pBuf[x0]) x0++;
+      if (x0 == W) {
+        continue;
+      }
+      while (!pBuf[x1]) x1--;
+      markDirty(page, x0, x1);
+      memset(pBuf + x0, 0, x1 - x0 + 1);
+    }
+  }
+
+  boolean isBusy(void) {
+    return SSD1306_TWI::isBusy();
+  }
+
+  uint16_t getFrameBytes(void) {
+    return _frameBytes;
+  }
+
+  // bytes put on the bus since begin(), for bus load measurements
+  uint32_t getBusBytes(void) {
+    return _busBytes;
+  }
+
+  uint32_t getI2CClock(void) {
+    return _i2cClock;
+  }
+
+  // called when a display() transfer ends, from the TWI interrupt in async builds
+  void setDisplayCallback(void (*callback)(void)) {
+    _displayCallback = callback;
+  }
+
+  void setI2CClock(uint32_t clock) {
+    _i2cClock = clock;
+    SSD1306_TWI::setClock(clock);
+  }
+
+  void invertDisplay(boolean i) {
+    command(i ? SSD1306_INVERTDISPLAY : SSD1306_NORMALDISPLAY);
+  }
+
+  void dim(boolean dim) {
+    const uint8_t cmds[] = { SSD1306_SETCONTRAST, (uint8_t)(dim ? 0 : contrast()) };
+
+    commands(cmds, sizeof(cmds));
+  }
+
+  uint8_t *getBuffer(void) {
+    return _buffer;
+  }
+
+  // the rotation is a template parameter
+  void setRotation(uint8_t) {
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (((uint16_t)x >= LOGICAL_WIDTH) || ((uint16_t)y >= LOGICAL_HEIGHT))
+      return;
+
+    if (ROT == 1) {
+      int16_t t = x; x = W - y - 1; y = t;
+    } else if (ROT == 2) {
+      x = W - x - 1; y = H - y - 1;
+    } else if (ROT == 3) {
+      int16_t t = x; x = y; y = H - t - 1;
+    }
+
+    uint8_t *pBuf = bufferAt(y/8, x);
+
+    if (pBuf) {
+      markDirty(y/8, x, x);
+      blit(pBuf, 1 << (y&7), color);
+    }
+  }
+
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (ROT == 0)      hLine(x, y, w, color);
+    else if (ROT == 1) vLine(W - y - 1, x, w, color);
+    else if (ROT == 2) hLine(W - x - w, H - y - 1, w, color);
+    else               vLine(y, H - x - w, w, color);
+  }
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (ROT == 0)      vLine(x, y, h, color);
+    else if (ROT == 1) hLine(W - y - h, x, h, color);
+    else if (ROT == 2) vLine(W - x - 1, H - y - h, h, color);
+    else               hLine(y, H - x - 1, h, color);
+  }
+
+  // classic font fast path, see Adafruit_SSD1306::drawCharColumns()
+  boolean drawCharColumns(int16_t x, int16_t y, const uint8_t *glyph,
+                          uint16_t color, uint16_t bg) {
+    if ((ROT != 0) || (x < 0) || (x > W - 6) || (y < 0) || (y > H - 8))
+      return false;
+
+    uint8_t *top = bufferAt(y/8, x);
+    uint8_t shift = y & 7;
+    uint8_t *bottom = shift ? bufferAt(y/8 + 1, x) : NULL;
+    uint8_t columns = (bg != color) ? 6 : 5;
+
+    if (top) {
+      markDirty(y/8, x, x+columns-1);
+    }
+    if (bottom) {
+      markDirty(y/8 + 1, x, x+columns-1);
+    }
+
+    for (uint8_t i=0; i<columns; i++) {
+      uint8_t line = (i < 5) ? pgm_read_byte(glyph + i) : 0;
+
+      if (top) {
+        blitGlyph(top++, line << shift, 0xFF << shift, color, bg);
+      }
+      if (bottom) {
+        blitGlyph(bottom++, line >> (8-shift), 0xFF >> (8-shift), color, bg);
+      }
+    }
+    return true;
+  }
+
+ private:
+  uint8_t _buffer[BUFFER_SIZE];
+  uint8_t _dirtyStart[PAGES];                 // clean when start > end
+  uint8_t _dirtyEnd[PAGES];
+  uint8_t _page0;                             // first page in _buffer (paged mode)
+  int8_t _rst;
+  uint8_t _i2caddr, _vccstate;
+  uint16_t _frameBytes;
+  uint32_t _busBytes;
+  void (*_displayCallback)(void);
+  uint32_t _i2cClock;
+
+  uint8_t contrast(void) {
+    if (H != 64) {
+      return 0x8F;
+    }
+    return (_vccstate == SSD1306_EXTERNALVCC) ? 0x9F : 0xCF;
+  }
+
+  uint8_t page0(void) {
+    return PAGED ? _page0 : 0;
+  }
+
+  // framebuffer byte of panel page and column, NULL if the page is not in RAM
+  uint8_t *bufferAt(uint8_t page, uint8_t x) {
+    if (PAGED && (uint8_t)(page - _page0) >= BUF_PAGES) {
+      return NULL;
+    }
+    return &_buffer[(page - page0())*W + x];
+  }
+
+  void markDirty(uint8_t page, uint8_t x0, uint8_t x1) {
+    if (x0 < _dirtyStart[page]) _dirtyStart[page] = x0;
+    if (x1 > _dirtyEnd[page])   _dirtyEnd[page]   = x1;
+  }
+
+  void markClean(uint8_t page) {
+    _dirtyStart[page] = 0xFF;
+    _dirtyEnd[page]   = 0;
+  }
+
+  void markAllDirty(void) {
+    for (uint8_t page=page0(); page<page0()+BUF_PAGES && page<PAGES; page++) {
+      _dirtyStart[page] = 0;
+      _dirtyEnd[page]   = W - 1;
+    }
+  }
+
+  static void blit(uint8_t *pBuf, uint8_t bits, uint16_t color) {
+    switch (color) {
+      case WHITE:   *pBuf |=  bits; break;
+      case BLACK:   *pBuf &= ~bits; break;
+      case INVERSE: *pBuf ^=  bits; break;
+    }
+  }
+
+  // bits drawn with color, the rest of mask with bg (if opaque)
+  static void blitGlyph(uint8_t *pBuf, uint8_t bits, uint8_t mask, uint16_t color, uint16_t bg) {
+    blit(pBuf, bits, color);
+    if (bg != color) {
+      blit(pBuf, mask & ~bits, bg);
+    }
+  }
+
+  // panel coordinates from here on
+  void hLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if ((uint16_t)y >= H) return;
+    if (x < 0) { w += x; x = 0; }
+    if (x + w > W) w = W - x;
+    if (w <= 0) return;
+
+    uint8_t *pBuf = bufferAt(y/8, x);
+    uint8_t mask = 1 << (y&7);
+
+    if (!pBuf) return;
+    markDirty(y/8, x, x+w-1);
+    while (w--) {
+      blit(pBuf++, mask, color);
+    }
+  }
+
+  void vLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if ((uint16_t)x >= W) return;
+    if (y < 0) { h += y; y = 0; }
+    if (y + h > H) h = H - y;
+    if (h <= 0) return;
+
+    uint8_t y0 = y, y1 = y + h - 1;
+
+    for (uint8_t page=y0/8; page<=y1/8; page++) {
+      uint8_t *pBuf = bufferAt(page, x);
+      uint8_t mask = 0xFF;
+
+      if (!pBuf) continue;
+      if (page == y0/8) mask &= 0xFF << (y0 & 7);
+      if (page == y1/8) mask &= 0xFF >> (7 - (y1 & 7));
+      markDirty(page, x, x);
+      blit(pBuf, mask, color);
+    }
+  }
+};
+
+template <uint8_t W, uint8_t H, uint8_t ROT, uint8_t BUF_PAGES> constexpr uint8_t  SSD1306_Display<W, H, ROT, BUF_PAGES>::PAGES;
+template <uint8_t W, uint8_t H, uint8_t ROT, uint8_t BUF_PAGES> constexpr bool     SSD1306_Display<W, H, ROT, BUF_PAGES>::PAGED;
+template <uint8_t W, uint8_t H, uint8_t ROT, uint8_t BUF_PAGES> constexpr uint16_t SSD1306_Display<W, H, ROT, BUF_PAGES>::BUFFER_SIZE;
+template <uint8_t W, uint8_t H, uint8_t ROT, uint8_t BUF_PAGES> constexpr int16_t  SSD1306_Display<W, H, ROT, BUF_PAGES>::LOGICAL_WIDTH;
+template <uint8_t W, uint8_t H, uint8_t ROT, uint8_t BUF_PAGES> constexpr int16_t  SSD1306_Display<W, H, ROT, BUF_PAGES>::LOGICAL_HEIGHT;
+
+#endif // SSD1306_HAVE_TWI
+
+#endif // _SSD1306_DISPLAY_H_
@@ -0,0 +1,299 @@
+/*********************************************************************
+Interrupt driven TWI (I2C) transport for SSD1306 displays on AVR.
+See SSD1306_TWI.h
+*********************************************************************/
+
+#include "SSD1306_TWI.h"
+
+// extra bytes we accept sending to merge two dirty pages into one window,
+// roughly what the six COLUMNADDR/PAGEADDR command transactions cost on I2C
+#define SSD1306_WINDOW_OVERHEAD 24
+
+uint8_t SSD1306_dirtyWindows(const uint8_t *dirtyStart, const uint8_t *dirtyEnd,
+                             uint8_t pages, SSD1306_TWIWindow *windows) {
+  uint8_t count = 0;
+  uint8_t page = 0;
+
+  while (page < pages) {
+    if (dirtyStart[page] > dirtyEnd[page]) {
+      page++;
+      continue;
+    }
+
+    SSD1306_TWIWindow *w = &windows[count++];
+    uint16_t used;
+
+    w->page0 = page;
+    w->col0  = dirtyStart[page];
+    w->col1  = dirtyEnd[page];
+    used = w->col1 - w->col0 + 1;
+
+    while (++page < pages && dirtyStart[page] <= dirtyEnd[page]) {
+      uint8_t c0 = min(w->col0, dirtyStart[page]);
+      uint8_t c1 = max(w->col1, dirtyEnd[page]);
+      uint16_t span = dirtyEnd[page] - dirtyStart[page] + 1;
+
+      if ((uint16_t)(page - w->page0 + 1) * (c1 - c0 + 1) > used + span + SSD1306_WINDOW_OVERHEAD) {
+        break;
+      }
+      w->col0 = c0;
+      w->col1 = c1;
+      used += span;
+    }
+    w->page1 = page - 1;
+  }
+  return count;
+}
+
+#ifdef SSD1306_HAVE_TWI
+
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#define TWI_IDLE 0
+#define TWI_CMD  1
+#define TWI_DATA 2
+
+// TWCR values for the next bus action, twiIE is _BV(TWIE) for interrupt
+// driven transfers and 0 when the state machine is polled
+#define TWCR_NEXT  (_BV(TWINT) | _BV(TWEN) | twiIE)
+#define TWCR_START (_BV(TWINT) | _BV(TWSTA) | _BV(TWEN) | twiIE)
+#define TWCR_STOP  (_BV(TWINT) | _BV(TWSTO) | _BV(TWEN))
+
+static volatile uint8_t twiState = TWI_IDLE;
+static uint8_t twiIE;
+static uint8_t twiAddr;
+static boolean twiControl;                    // control byte still to be sent
+static uint8_t twiErrors;
+
+// command transaction
+static uint8_t twiCmd[SSD1306_TWI_MAX_COMMANDS];
+static uint8_t twiCmdLen, twiCmdPos;
+
+// data transactions, one per window
+static const uint8_t *twiBuffer;
+static uint8_t twiWidth, twiFirstPage;
+static SSD1306_TWIWindow twiWindows[SSD1306_TWI_MAX_WINDOWS];
+static uint8_t twiWindowCount, twiWindowIndex;
+static const uint8_t *twiData;
+static uint8_t twiCol, twiCols, twiRows;
+
+static void (*twiCallback)(void);
+
+// address commands of the current window
+static void twiLoadWindow(void) {
+  const SSD1306_TWIWindow *w = &twiWindows[twiWindowIndex];
+
+  twiCmd[0] = 0x21;                           // SSD1306_COLUMNADDR
+  twiCmd[1] = w->col0;
+  twiCmd[2] = w->col1;
+  twiCmd[3] = 0x22;                           // SSD1306_PAGEADDR
+  twiCmd[4] = w->page0;
+  twiCmd[5] = w->page1;
+  twiCmdLen = 6;
+  twiCmdPos = 0;
+
+  twiData = twiBuffer + (w->page0 - twiFirstPage) * twiWidth + w->col0;
+  twiCols = w->col1 - w->col0 + 1;
+  twiCol  = twiCols;
+  twiRows = w->page1 - w->page0 + 1;
+}
+
+static void twiFinish(void) {
+  boolean frame = (twiWindowCount != 0);
+
+  TWCR = TWCR_STOP;
+  twiWindowCount = 0;
+  twiState = TWI_IDLE;
+  if (frame && twiCallback) {
+    twiCallback();
+  }
+}
+
+// master transmitter state machine, one step per TWINT
+static void twiStep(void) {
+  switch (TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = (twiAddr << 1) | TW_WRITE;
+      twiControl = true;
+      TWCR = TWCR_NEXT;
+      return;
+
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (twiControl) {
+        TWDR = (twiState == TWI_DATA) ? 0x40 : 0x00;
+        twiControl = false;
+        TWCR = TWCR_NEXT;
+        return;
+      }
+
+      if (twiState == TWI_CMD) {
+        if (twiCmdPos < twiCmdLen) {
+          TWDR = twiCmd[twiCmdPos++];
+          TWCR = TWCR_NEXT;
+          return;
+        }
+        if (twiWindowIndex < twiWindowCount) {
+          twiState = TWI_DATA;
+          TWCR = TWCR_START;                  // repeated start for the data
+          return;
+        }
+      } else {
+        if (twiRows) {
+          TWDR = *twiData++;
+          if (--twiCol == 0) {
+            twiCol = twiCols;
+            twiData += twiWidth - twiCols;
+            twiRows--;
+          }
+          TWCR = TWCR_NEXT;
+          return;
+        }
+        if (++twiWindowIndex < twiWindowCount) {
+          twiLoadWindow();
+          twiState = TWI_CMD;
+          TWCR = TWCR_START;
+          return;
+        }
+      }
+      twiFinish();
+      return;
+
+    default:                                  // NACK, lost arbitration or bus error
+      twiErrors++;
+      twiFinish();
+      return;
+  }
+}
+
+#ifdef SSD1306_TWI_ASYNC
+ISR(TWI_vect) {
+  twiStep();
+}
+#endif
+
+static void twiStart(void) {
+  __asm__ __volatile__ ("" ::: "memory");     // job set up before the ISR runs
+  while (TWCR & _BV(TWSTO));                  // previous stop still on the bus
+  TWCR = TWCR_START;
+}
+
+// Run the job with the TWI interrupt disabled, stepping the state machine by
+// polling TWINT. Leaves TWCR as it was, so Wire keeps working afterwards.
+static void twiRunPolled(void) {
+  uint8_t twcr = TWCR & ~_BV(TWINT);
+
+  twiIE = 0;
+  twiStart();
+  while (twiState != TWI_IDLE) {
+    if (TWCR & _BV(TWINT)) {
+      twiStep();
+    }
+  }
+  while (TWCR & _BV(TWSTO));
+  TWCR = twcr;
+}
+
+static void twiLoadWindows(uint8_t addr, const uint8_t *buffer, uint8_t width,
+                           const SSD1306_TWIWindow *windows, uint8_t count,
+                           uint8_t firstPage) {
+  if (count > SSD1306_TWI_MAX_WINDOWS) {
+    count = SSD1306_TWI_MAX_WINDOWS;
+  }
+  memcpy(twiWindows, windows, count * sizeof(SSD1306_TWIWindow));
+  twiWindowCount = count;
+  twiWindowIndex = 0;
+  twiBuffer = buffer;
+  twiWidth = width;
+  twiFirstPage = firstPage;
+  twiAddr = addr;
+  twiLoadWindow();
+  twiState = TWI_CMD;
+}
+
+void SSD1306_TWI::begin(uint32_t clock) {
+  // internal pull-ups, like Wire does
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+
+  setClock(clock);
+  TWCR = _BV(TWEN);
+}
+
+// SCL = F_CPU / (16 + 2 * TWBR), with the prescaler at 1.
+// 800 kHz and 1 MHz (TWBR 2 and 0 at 16 MHz) are out of the I2C fast mode
+// spec, but most SSD1306 modules take them with short wires.
+void SSD1306_TWI::setClock(uint32_t clock) {
+  uint32_t div = F_CPU / clock;
+
+  TWSR = 0;
+  TWBR = (div > 16) ? (div - 16) / 2 : 0;
+}
+
+void SSD1306_TWI::writeCommands(uint8_t addr, const uint8_t *cmds, uint8_t len) {
+  waitIdle();
+
+  if (len > SSD1306_TWI_MAX_COMMANDS) {
+    len = SSD1306_TWI_MAX_COMMANDS;
+  }
+  memcpy(twiCmd, cmds, len);
+  twiCmdLen = len;
+  twiCmdPos = 0;
+  twiWindowCount = 0;
+  twiAddr = addr;
+  twiState = TWI_CMD;
+  twiRunPolled();
+}
+
+void SSD1306_TWI::writeWindowsPolled(uint8_t addr, const uint8_t *buffer, uint8_t width,
+                                     const SSD1306_TWIWindow *windows, uint8_t count,
+                                     uint8_t firstPage) {
+  waitIdle();
+
+  if (!count) {
+    return;
+  }
+  twiLoadWindows(addr, buffer, width, windows, count, firstPage);
+  twiRunPolled();
+}
+
+#ifdef SSD1306_TWI_ASYNC
+void SSD1306_TWI::writeWindows(uint8_t addr, const uint8_t *buffer, uint8_t width,
+                               const SSD1306_TWIWindow *windows, uint8_t count,
+                               uint8_t firstPage) {
+  waitIdle();
+
+  if (!count) {
+    return;
+  }
+  twiLoadWindows(addr, buffer, width, windows, count, firstPage);
+  twiIE = _BV(TWIE);
+  twiStart();
+}
+#endif
+
+boolean SSD1306_TWI::isBusy(void) {
+  return twiState != TWI_IDLE;
+}
+
+// Spin until the transfer ends. With interrupts disabled (e.g. from a global
+// constructor, before init()) the state machine is stepped by polling TWINT.
+void SSD1306_TWI::waitIdle(void) {
+  while (twiState != TWI_IDLE) {
+    if (!(SREG & _BV(SREG_I)) && (TWCR & _BV(TWINT))) {
+      twiStep();
+    }
+  }
+}
+
+void SSD1306_TWI::onComplete(void (*callback)(void)) {
+  twiCallback = callback;
+}
+
+uint8_t SSD1306_TWI::getErrors(void) {
+  return twiErrors;
+}
+
+#endif // SSD1306_HAVE_TWI
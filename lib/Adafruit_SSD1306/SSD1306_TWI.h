@@ -0,0 +1,80 @@
+/*********************************************************************
+Register level TWI (I2C) transport for SSD1306 displays on AVR.
+
+Every dirty window is sent as one command transaction (COLUMNADDR/PAGEADDR)
+followed by one data transaction, without the 32 byte chunking of the Wire
+library: a full 128x64 frame is a single 1025 byte burst.
+
+The same state machine runs in two ways:
+  - polled (writeCommands, writeWindowsPolled): blocking, the TWI interrupt
+    stays disabled, so it can share the bus with Wire.
+  - interrupt driven (writeWindows): the framebuffer is streamed from the
+    TWI interrupt, so display() only starts the transfer and returns at
+    once. This owns TWI_vect and can not be linked together with Wire.
+    Enable it with -D SSD1306_TWI_ASYNC (see platformio.ini) and do not
+    use Wire for other devices on the same bus.
+*********************************************************************/
+#ifndef _SSD1306_TWI_H_
+#define _SSD1306_TWI_H_
+
+#if ARDUINO >= 100
+ #include "Arduino.h"
+#else
+ #include "WProgram.h"
+#endif
+
+// One rectangular area of the framebuffer, in pages and columns (inclusive)
+typedef struct {
+  uint8_t page0, page1;
+  uint8_t col0, col1;
+} SSD1306_TWIWindow;
+
+#define SSD1306_TWI_MAX_WINDOWS 8
+#define SSD1306_TWI_MAX_COMMANDS 8
+
+// Merge the dirty column spans of pages [0, pages) into windows, joining
+// consecutive pages when the extra bytes are cheaper than a new window.
+// A page is clean when dirtyStart > dirtyEnd. Returns the window count,
+// windows must have room for pages entries.
+uint8_t SSD1306_dirtyWindows(const uint8_t *dirtyStart, const uint8_t *dirtyEnd,
+                             uint8_t pages, SSD1306_TWIWindow *windows);
+
+#if defined(__AVR__) && defined(TWCR)
+ #define SSD1306_HAVE_TWI
+#endif
+
+#ifdef SSD1306_HAVE_TWI
+
+class SSD1306_TWI {
+ public:
+  static void begin(uint32_t clock = 400000L);
+  static void setClock(uint32_t clock);
+
+  // buffer holds the pages from firstPage on (0 for a whole framebuffer,
+  // the band start for paged rendering)
+
+  // blocking, wait for any transfer in progress before sending
+  static void writeCommands(uint8_t addr, const uint8_t *cmds, uint8_t len);
+  static void writeWindowsPolled(uint8_t addr, const uint8_t *buffer, uint8_t width,
+                                 const SSD1306_TWIWindow *windows, uint8_t count,
+                                 uint8_t firstPage = 0);
+
+#ifdef SSD1306_TWI_ASYNC
+  // non blocking, the windows are copied but buffer must stay valid until done
+  static void writeWindows(uint8_t addr, const uint8_t *buffer, uint8_t width,
+                           const SSD1306_TWIWindow *windows, uint8_t count,
+                           uint8_t firstPage = 0);
+#endif
+
+  static boolean isBusy(void);
+  static void waitIdle(void);
+
+  // called when a window transfer ends, from the TWI interrupt for writeWindows()
+  static void onComplete(void (*callback)(void));
+
+  static uint8_t getErrors(void);
+};
+
+#endif // SSD1306_HAVE_TWI
+
+#endif // _SSD1306_TWI_H_
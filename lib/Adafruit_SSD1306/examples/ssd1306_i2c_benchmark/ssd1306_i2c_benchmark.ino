@@ -0,0 +1,80 @@
+/*********************************************************************
+Frame time benchmark for the SSD1306 I2C transports.
+
+Sends full frames (every page dirty) and partial frames (one text line)
+through the Wire path and the direct TWI path at several bus clocks, and
+prints the average time per display() call over the serial port.
+
+Build without SSD1306_TWI_ASYNC: the Wire path is not linked in async builds.
+*********************************************************************/
+
+#include <SPI.h>
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+
+#define OLED_RESET 4
+Adafruit_SSD1306 display(OLED_RESET);
+
+#define FRAMES 20
+
+const uint32_t clocks[] = { 400000L, 800000L, 1000000L };
+
+// average microseconds per display() call
+unsigned long benchmark(boolean fullFrame) {
+  unsigned long start, total = 0;
+
+  for (uint8_t i=0; i<FRAMES; i++) {
+    if (fullFrame) {
+      display.fillScreen(i & 1);
+    } else {
+      display.fillRect(0, 0, display.width(), 8, BLACK);
+      display.setCursor(0, 0);
+      display.print(i);
+    }
+    start = micros();
+    display.display();
+    while (display.isBusy());
+    total += micros() - start;
+  }
+  return total / FRAMES;
+}
+
+void report(const char *transport, uint32_t clock) {
+  display.setI2CClock(clock);
+
+  unsigned long full = benchmark(true);
+  uint16_t fullBytes = display.getFrameBytes();
+  unsigned long line = benchmark(false);
+  uint16_t lineBytes = display.getFrameBytes();
+
+  Serial.print(transport);
+  Serial.print(" @ ");
+  Serial.print(clock / 1000);
+  Serial.print(" kHz: full frame ");
+  Serial.print(full);
+  Serial.print(" us (");
+  Serial.print(fullBytes);
+  Serial.print(" bytes), text line ");
+  Serial.print(line);
+  Serial.print(" us (");
+  Serial.print(lineBytes);
+  Serial.println(" bytes)");
+}
+
+void setup()   {
+  Serial.begin(115200);
+
+  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  display.setTextColor(WHITE);
+
+  for (uint8_t c=0; c<sizeof(clocks)/sizeof(clocks[0]); c++) {
+    display.setI2CTransport(SSD1306_I2C_WIRE);
+    report("Wire  ", clocks[c]);
+    display.setI2CTransport(SSD1306_I2C_DIRECT);
+    report("Direct", clocks[c]);
+  }
+}
+
+void loop() {
+}
@@ -0,0 +1,63 @@
+/*********************************************************************
+Text drawing benchmark for the classic 5x7 font.
+
+Draws a few hundred characters into the framebuffer (display() is never
+called, only drawing is measured) and prints the CPU cycles per character:
+  - page aligned fast path (y multiple of 8)
+  - unaligned fast path (two shifted bytes per glyph column)
+  - generic per-pixel drawChar(), forced with rotation 2
+for transparent and opaque (background color) text.
+*********************************************************************/
+
+#include <SPI.h>
+#include <Wire.h>
+#include <Adafruit_GFX.h>
+#include <Adafruit_SSD1306.h>
+
+#define OLED_RESET 4
+Adafruit_SSD1306 display(OLED_RESET);
+
+#define CHARS 210
+
+// average CPU cycles per drawChar() call
+unsigned long benchmark(uint8_t rotation, int16_t y, boolean opaque) {
+  unsigned long start, elapsed;
+  int16_t x = 0;
+
+  display.setRotation(rotation);
+  start = micros();
+  for (uint8_t i=0; i<CHARS; i++) {
+    display.drawChar(x, y, 'A' + (i % 26), WHITE, opaque ? BLACK : WHITE, 1);
+    x += 6;
+    if (x > SSD1306_LCDWIDTH - 6) {
+      x = 0;
+    }
+  }
+  elapsed = micros() - start;
+  display.setRotation(0);
+
+  return elapsed * (F_CPU / 1000000L) / CHARS;
+}
+
+void report(const char *name, uint8_t rotation, int16_t y) {
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(benchmark(rotation, y, false));
+  Serial.print(" cycles/char transparent, ");
+  Serial.print(benchmark(rotation, y, true));
+  Serial.println(" cycles/char opaque");
+}
+
+void setup()   {
+  Serial.begin(115200);
+
+  display.begin(SSD1306_SWITCHCAPVCC, 0x3C);
+  display.clearDisplay();
+
+  report("aligned   (y=8)", 0, 8);
+  report("unaligned (y=11)", 0, 11);
+  report("generic   (rot 2)", 2, 8);
+}
+
+void loop() {
+}
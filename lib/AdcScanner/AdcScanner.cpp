@@ -0,0 +1,127 @@
+/*********************************************************************
+Background ADC acquisition for AVR. See AdcScanner.h
+*********************************************************************/
+
+#include "AdcScanner.h"
+
+#include <avr/interrupt.h>
+
+// auto trigger source (ADCSRB ADTS2:0) 100: Timer/Counter0 overflow
+#define ADC_TRIGGER_TIMER0_OVF  _BV(ADTS2)
+// 16 MHz / 128 = 125 kHz ADC clock, 104 us per conversion
+#define ADC_PRESCALER           (_BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0))
+
+static uint8_t adcMux[ADC_SCANNER_MAX_CHANNELS];  // ADMUX value per channel
+static uint8_t adcCount;
+
+// accumulation, only touched by the interrupt while running
+static uint16_t adcSum[ADC_SCANNER_MAX_CHANNELS];
+static uint8_t adcIndex;                           // channel being converted
+static uint8_t adcSamples;
+
+// results: the interrupt writes the bank the reader is not using, then flips
+// adcBank (a single byte, so the flip is atomic). Sums of 64 samples of 10
+// bits are the reading scaled to 16 bits.
+static uint16_t adcResult[2][ADC_SCANNER_MAX_CHANNELS];
+static volatile uint8_t adcBank;
+static volatile uint8_t adcSequence;
+static uint8_t adcSeen;
+
+
+void AdcScanner::begin(const uint8_t *pins, uint8_t count) {
+  end();
+
+  if (count > ADC_SCANNER_MAX_CHANNELS) {
+    count = ADC_SCANNER_MAX_CHANNELS;
+  }
+  for (uint8_t i=0; i<count; i++) {
+    uint8_t channel = pins[i];
+
+#ifdef A0
+    if (channel >= A0) {
+      channel -= A0;                   // same mapping as analogRead()
+    }
+#endif
+    adcMux[i] = _BV(REFS0) | (channel & 0x0F);
+#ifdef DIDR0
+    if (channel < 6) {
+      DIDR0 |= _BV(channel);           // digital input buffer off, less noise
+    }
+#endif
+    adcSum[i] = 0;
+    adcResult[0][i] = 0;
+    adcResult[1][i] = 0;
+  }
+  adcCount   = count;
+  adcIndex   = 0;
+  adcSamples = 0;
+  adcSeen    = adcSequence;
+
+  if (count == 0) {
+    return;
+  }
+  ADMUX  = adcMux[0];
+  ADCSRB = ADC_TRIGGER_TIMER0_OVF;
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADIF) | ADC_PRESCALER;
+}
+
+
+void AdcScanner::end() {
+  // back to the state the Arduino core leaves for analogRead()
+  ADCSRA = _BV(ADEN) | ADC_PRESCALER;
+  ADCSRB = 0;
+}
+
+
+boolean AdcScanner::available() {
+  uint8_t sequence = adcSequence;
+
+  if (sequence == adcSeen) {
+    return false;
+  }
+  adcSeen = sequence;
+  return true;
+}
+
+
+uint8_t AdcScanner::sequence() {
+  return adcSequence;
+}
+
+
+// The bank being read is only rewritten one whole set later (over 100 ms),
+// so no interrupt lock is needed for a 16 bit read.
+uint16_t AdcScanner::read16(uint8_t index) {
+  return (index < adcCount) ? adcResult[adcBank][index] : 0;
+}
+
+
+uint16_t AdcScanner::read(uint8_t index) {
+  return read16(index) >> (16 - ADC_SCANNER_BITS);
+}
+
+
+ISR(ADC_vect) {
+  uint8_t i = adcIndex;
+
+  adcSum[i] += ADC;
+
+  // the next conversion starts on the next Timer0 overflow, over 900 us
+  // from now, so the multiplexer has settled by then
+  if (++i == adcCount) {
+    i = 0;
+    if (++adcSamples == ADC_SCANNER_OVERSAMPLING) {
+      uint8_t bank = adcBank ^ 1;
+
+      for (uint8_t c=0; c<adcCount; c++) {
+        adcResult[bank][c] = adcSum[c];
+        adcSum[c] = 0;
+      }
+      adcBank = bank;
+      adcSequence++;
+      adcSamples = 0;
+    }
+  }
+  adcIndex = i;
+  ADMUX = adcMux[i];
+}
@@ -0,0 +1,55 @@
+/*********************************************************************
+Background ADC acquisition for AVR (ATmega328 and friends).
+
+The ADC is auto-triggered by the Timer0 overflow that the Arduino core
+already runs for millis() (F_CPU/64/256, 976.5625 Hz at 16 MHz), so the
+sample clock is steady and no timer is taken from the sketch. The ADC
+interrupt reads each conversion, moves the multiplexer to the next
+configured channel and accumulates ADC_SCANNER_OVERSAMPLING samples per
+channel. 4^3 = 64 samples of 10 bits give 3 extra bits: every finished
+set is published as 13 bit values (0..8191) into a double buffer, so
+reading a result never blocks and never disables interrupts.
+
+  static const uint8_t pins[] = {A0, A1};
+  AdcScanner::begin(pins, 2);
+  ...
+  if (AdcScanner::available()) {
+    uint16_t t = AdcScanner::read(0);          // 13 bits
+    uint16_t u = AdcScanner::read16(1);        // scaled to 16 bits
+  }
+
+With 2 channels a new set is ready every 2 * 64 / 976.56 = 131 ms.
+analogRead() must not be used while the scanner runs.
+*********************************************************************/
+#ifndef ADC_SCANNER_H
+#define ADC_SCANNER_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define ADC_SCANNER_MAX_CHANNELS  4
+#define ADC_SCANNER_OVERSAMPLING  64      // samples per channel and result
+#define ADC_SCANNER_EXTRA_BITS    3       // log4(ADC_SCANNER_OVERSAMPLING)
+#define ADC_SCANNER_BITS          (10 + ADC_SCANNER_EXTRA_BITS)
+
+class AdcScanner {
+  public:
+    // pins as for analogRead() (A0..A7, or the channel number), AVcc reference
+    static void begin(const uint8_t *pins, uint8_t count);
+    static void end();
+
+    // true once per new set of results
+    static boolean available();
+    // incremented by the interrupt for every published set
+    static uint8_t sequence();
+
+    // last finished value of channel index, ADC_SCANNER_BITS bits
+    static uint16_t read(uint8_t index);
+    // the same value scaled to 16 bits (0..65535 full scale)
+    static uint16_t read16(uint8_t index);
+};
+
+#endif  // ADC_SCANNER_H
@@ -0,0 +1,125 @@
+#include <FlowMeter.h>  // https://github.com/sekdiy/FlowMeter
+
+// Benchmark and equivalence check of the fixed point tick with a calibration curve.
+//
+// Prints the CPU cycles of tick() and of the same calculation in double precision,
+// then sweeps pulse rates and tick durations and compares flow rate and total volume
+// with the double precision reference of the same interpolated curve.
+
+FlowSensorProperties MySensor = {60.0f, 4.5f, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+
+// meter factor over the pulse rate, breakpoints anywhere
+const FlowCalibrationPoint MyCurve[] PROGMEM = {
+  {FLOW_MILLIHZ(1.0), FLOW_Q16(1.20)},
+  {FLOW_MILLIHZ(6.0), FLOW_Q16(1.08)},
+  {FLOW_MILLIHZ(20.0), FLOW_Q16(1.02)},
+  {FLOW_MILLIHZ(90.0), FLOW_Q16(1.00)},
+  {FLOW_MILLIHZ(200.0), FLOW_Q16(0.93)},
+  {FLOW_MILLIHZ(270.0), FLOW_Q16(0.80)}
+};
+#define CURVE_POINTS (sizeof(MyCurve) / sizeof(MyCurve[0]))
+
+FlowMeter Meter = FlowMeter(3, MySensor);
+
+#define RUNS 200
+
+volatile double fsink;
+
+// the meter factor of MyCurve in double precision
+double referenceFactor(double hz) {
+  double f0 = pgm_read_dword(&MyCurve[0].frequency) / 1000.0;
+  double m0 = pgm_read_dword(&MyCurve[0].mFactor) / 65536.0;
+
+  if (hz <= f0) {
+    return m0;
+  }
+  for (unsigned int i = 1; i < CURVE_POINTS; i++) {
+    double f1 = pgm_read_dword(&MyCurve[i].frequency) / 1000.0;
+    double m1 = pgm_read_dword(&MyCurve[i].mFactor) / 65536.0;
+    if (hz <= f1) {
+      return m0 + (m1 - m0) * (hz - f0) / (f1 - f0);
+    }
+    f0 = f1;
+    m0 = m1;
+  }
+  return m0;
+}
+
+// flow rate (in µl/s) of pulses within duration (in ms), in double precision
+double referenceFlow(unsigned long pulses, unsigned long duration) {
+  double hz = pulses * 1000.0 / duration;
+  return hz / (60.0 * MySensor.kFactor) * referenceFactor(hz) * 1000000.0;
+}
+
+// average CPU cycles per tick
+unsigned long cyclesFixed() {
+  unsigned long total = 0;
+
+  for (unsigned int i = 0; i < RUNS; i++) {
+    for (unsigned int p = 0; p < (i & 255); p++) {
+      Meter.count();
+    }
+    unsigned long start = micros();
+    Meter.tick(1000);
+    total += micros() - start;
+  }
+  return total * (F_CPU / 1000000L) / RUNS;
+}
+
+unsigned long cyclesDouble() {
+  unsigned long start = micros();
+
+  for (unsigned int i = 0; i < RUNS; i++) {
+    fsink = referenceFlow(i & 255, 1000);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+void setup() {
+  Serial.begin(9600);
+  Meter.setCalibration(MyCurve, CURVE_POINTS);
+
+  Serial.print(F("tick: "));
+  Serial.print(cyclesFixed());
+  Serial.print(F(" cycles, double: "));
+  Serial.print(cyclesDouble());
+  Serial.println(F(" cycles"));
+
+  // equivalence: every pulse count from 1 to 300 at several tick durations
+  static const unsigned int durations[] = {250, 500, 1000, 1700};
+  double worst = 0;
+  double volume = 0;
+  Meter.reset();
+  unsigned long startMl = Meter.getTotalVolumeMl();
+  double start = Meter.getTotalVolume();
+
+  for (unsigned int d = 0; d < sizeof(durations) / sizeof(durations[0]); d++) {
+    for (unsigned long pulses = 1; pulses <= 300; pulses++) {
+      for (unsigned long p = 0; p < pulses; p++) {
+        Meter.count();
+      }
+      Meter.tick(durations[d]);
+
+      double reference = referenceFlow(pulses, durations[d]);
+      double error = fabs(Meter.getCurrentFlowUlps() - reference) / reference;
+      if (error > worst) {
+        worst = error;
+      }
+      volume += reference * durations[d] / 1000.0;   // µl
+    }
+  }
+  double total = (Meter.getTotalVolume() - start) * 1000000.0;
+  double totalError = fabs(total - volume) / volume;
+
+  Serial.print(F("worst flow error: "));
+  Serial.print(worst * 1000000.0, 1);
+  Serial.print(F(" ppm, total volume: "));
+  Serial.print(Meter.getTotalVolumeMl() - startMl);
+  Serial.print(F(" ml, error "));
+  Serial.print(totalError * 1000000.0, 1);
+  Serial.println(F(" ppm"));
+  Serial.println(worst < 0.001 && totalError < 0.0001 ? F("PASS") : F("FAIL"));
+}
+
+void loop() {
+}
@@ -0,0 +1,113 @@
+#include <FlowMeterPinChange.h>  // https://github.com/sekdiy/FlowMeter
+
+// Cycle budget of the pin change interrupt of FlowMeterPinChange.
+//
+// Eight meters on port D (pins 0-7, the serial port is closed meanwhile) are switched to outputs, so the
+// sketch makes the edges itself: writing the port raises the pin change interrupt like a sensor would.
+// Timer1 counts CPU cycles around the write, once with the interrupt enabled and once without; the
+// difference is the interrupt, entry and return included. Rising edges only update the state, falling
+// edges count, 1 to 8 meters at once. Then the load of 8 sensors at full scale, and a check of the counts.
+
+FlowMeterPinChange Meters[] = {
+  FlowMeterPinChange(0), FlowMeterPinChange(1), FlowMeterPinChange(2), FlowMeterPinChange(3),
+  FlowMeterPinChange(4), FlowMeterPinChange(5), FlowMeterPinChange(6), FlowMeterPinChange(7)
+};
+#define METERS 8
+
+#define RUNS 16
+#define FULL_SCALE_HZ 270UL                       // e.g. 60 l/min at 4.5 pulses per second per l/min
+
+// cycles of writing value to PORTD, with the interrupt it raises if enabled
+uint16_t cycles(uint8_t value) {
+  uint8_t sreg = SREG;
+  cli();
+  TCNT1 = 0;
+  PORTD = value;
+  asm volatile("nop\n\tnop\n\tnop\n\tnop");      // the pin synchronizer raises the flag meanwhile
+  sei();
+  asm volatile("nop");                            // the interrupt runs after the instruction following sei
+  uint16_t t = TCNT1;
+  SREG = sreg;
+  return t;
+}
+
+// worst case over RUNS edges from 0xFF to low, and back, minus the same writes without the interrupt
+void measure(uint8_t low, uint16_t &rising, uint16_t &falling) {
+  uint16_t fallingOn = 0, risingOn = 0, fallingOff = 0, risingOff = 0;
+
+  for (uint8_t enabled = 0; enabled < 2; enabled++) {
+    PCIFR = _BV(PCIF2);                           // edges of the previous loop without interrupt
+    PCICR = enabled ? _BV(PCIE2) : 0;
+    for (uint8_t i = 0; i < RUNS; i++) {
+      uint16_t f = cycles(low);
+      uint16_t r = cycles(0xFF);
+      if (enabled) {
+        fallingOn = max(fallingOn, f);
+        risingOn = max(risingOn, r);
+      } else {
+        fallingOff = max(fallingOff, f);
+        risingOff = max(risingOff, r);
+      }
+    }
+  }
+  rising = risingOn - risingOff;
+  falling = fallingOn - fallingOff;
+}
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println(F("pin change interrupt, cycles (rising edge / falling edges)"));
+  Serial.flush();
+  Serial.end();                                   // pins 0 and 1 are meters now
+
+  for (uint8_t i = 0; i < METERS; i++) {
+    Meters[i].begin();
+  }
+  PORTD = 0xFF;
+  DDRD = 0xFF;                                    // the edges come from the sketch
+
+  uint8_t timsk0 = TIMSK0;
+  TIMSK0 = 0;                                     // no millis() interrupt within the measurement
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);                             // Timer1 at clk / 1
+
+  uint16_t rising[METERS + 1], falling[METERS + 1];
+  for (uint8_t n = 1; n <= METERS; n++) {
+    measure(0xFF << n, rising[n], falling[n]);    // n meters fall at once
+  }
+
+  TCCR1B = 0;
+  TIMSK0 = timsk0;
+  PCICR = _BV(PCIE2);
+  DDRD = 0;
+
+  // meter i fell once per run with the interrupt enabled, in the loops with n > i
+  bool ok = true;
+  for (uint8_t i = 0; i < METERS; i++) {
+    ok = ok && Meters[i].getSnapshot().pulses == (unsigned long)RUNS * (METERS - i);
+  }
+  for (uint8_t i = 0; i < METERS; i++) {
+    Meters[i].end();
+  }
+
+  Serial.begin(9600);
+  for (uint8_t n = 1; n <= METERS; n++) {
+    Serial.print(n);
+    Serial.print(F(" meters: "));
+    Serial.print(rising[n]);
+    Serial.print(F(" / "));
+    Serial.println(falling[n]);
+  }
+
+  // 8 sensors at full scale, every edge separately (one interrupt per edge, worst case)
+  unsigned long perSecond = (rising[1] + falling[1]) * FULL_SCALE_HZ * METERS;
+  Serial.print(F("8 meters at "));
+  Serial.print(FULL_SCALE_HZ);
+  Serial.print(F(" Hz: "));
+  Serial.print(perSecond * 100.0 / F_CPU, 2);
+  Serial.println(F(" % CPU"));
+  Serial.println(ok ? F("PASS") : F("FAIL"));
+}
+
+void loop() {
+}
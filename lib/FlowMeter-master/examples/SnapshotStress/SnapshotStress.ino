@@ -0,0 +1,88 @@
+#include <FlowMeter.h>  // https://github.com/sekdiy/FlowMeter
+
+// Stress test of the pulse counter snapshot (FlowMeter::getSnapshot).
+//
+// Timer2 fires simulated flow pulses (Meter.count()) every 192..255 CPU cycles, the delay
+// growing by one cycle each time, so the interrupt sweeps over every instruction of the
+// reader loop. The loop takes snapshots as fast as it can and checks each against the
+// previous one: the same pulse count must come with the same timestamp, a new count with
+// a new timestamp, and the count never goes back. A naive copy without the sequence check
+// is tested the same way for comparison; it does tear.
+//
+// The host test in extras/host steps the reader load by load instead, through every
+// interleaving with the interrupt.
+
+#define RUN_MS 10000
+
+// a meter that can also read the way a reader without the sequence lock would (the members
+// are protected)
+class NaiveMeter : public FlowMeter {
+  public:
+    NaiveMeter() : FlowMeter(3, UncalibratedSensor) {}
+
+    FlowPulseSnapshot naiveSnapshot() {
+      FlowPulseSnapshot snapshot = {this->_pulses, this->_pulseTime};
+      return snapshot;
+    }
+};
+
+NaiveMeter Meter;
+
+volatile uint8_t jitter = 0;
+
+ISR(TIMER2_COMPA_vect) {
+  Meter.count();
+  OCR2A = 191 + (jitter++ & 63);                  // 1 cycle per step at clk / 1, above the interrupt's own length
+}
+
+// returns true if b can follow a
+bool consistent(const FlowPulseSnapshot &a, const FlowPulseSnapshot &b) {
+  long advance = (long)(b.pulses - a.pulses);
+
+  if (advance < 0) {
+    return false;
+  }
+  return (advance == 0) == (b.time == a.time);
+}
+
+unsigned long stress(bool naive) {
+  FlowPulseSnapshot last = naive ? Meter.naiveSnapshot() : Meter.getSnapshot();
+  unsigned long torn = 0, reads = 0;
+  unsigned long start = millis();
+
+  while (millis() - start < RUN_MS) {
+    FlowPulseSnapshot now = naive ? Meter.naiveSnapshot() : Meter.getSnapshot();
+    if (!consistent(last, now)) {
+      torn++;
+    }
+    last = now;
+    reads++;
+  }
+
+  Serial.print(naive ? F("naive:    ") : F("seqlock:  "));
+  Serial.print(reads);
+  Serial.print(F(" reads, "));
+  Serial.print(Meter.getSnapshot().pulses);
+  Serial.print(F(" pulses, "));
+  Serial.print(torn);
+  Serial.println(F(" torn"));
+  return torn;
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  TCCR2A = _BV(WGM21);                            // CTC
+  TCCR2B = _BV(CS20);                             // clk / 1
+  OCR2A = 191;
+  TIMSK2 = _BV(OCIE2A);
+
+  unsigned long torn = stress(false);
+  stress(true);
+
+  TIMSK2 = 0;
+  Serial.println(torn == 0 ? F("PASS") : F("FAIL"));
+}
+
+void loop() {
+}
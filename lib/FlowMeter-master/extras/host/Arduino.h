@@ -0,0 +1,27 @@
+/*
+ * Arduino core stub for host tests of the library (see SnapshotStress.cpp)
+ *
+ * Just enough for src/FlowMeter.cpp to compile with a desktop compiler. There are no interrupts: the test
+ * calls the interrupt routines itself, and micros() returns hostMicros, which the test sets.
+ */
+
+#ifndef ARDUINO_HOST_STUB_H
+#define ARDUINO_HOST_STUB_H
+
+#include <stdint.h>
+
+#define INPUT_PULLUP 2
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+extern unsigned long hostMicros;                  //!< the time of micros() (in µs)
+extern uint8_t SREG;                              //!< status register, for the save / restore around cli()
+
+inline unsigned long micros() { return hostMicros; }
+inline unsigned long millis() { return hostMicros / 1000; }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void cli() {}
+inline void sei() {}
+
+#endif   // ARDUINO_HOST_STUB_H
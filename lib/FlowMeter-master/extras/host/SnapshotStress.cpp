@@ -0,0 +1,219 @@
+/*
+ * Host test of the pulse counter snapshot (FlowMeter::getSnapshot), single stepped
+ *
+ * The AVR reads the 32 bit members of FlowMeter one byte at a time, and the interrupt (count()) can run
+ * between any two of those loads. Here the reader is written as its explicit loads, one per step: the
+ * sequence, the bytes of _pulses, the bytes of _pulseTime and the sequence again, retrying as
+ * getSnapshot() does. The test runs the reader step by step and calls the real count() before the steps
+ * of a schedule, for every schedule of up to MAX_INTERRUPTS interrupts over the first passes of the reader
+ * (several interrupts may hit the same step). The meter starts at values where count() carries across
+ * bytes (0x...FF pulses, timestamps stepping by 1 or 0x01010101, the sequence about to wrap), and the
+ * bytes are loaded in ascending and in descending order. On the host the members have the size of its
+ * unsigned long, which only adds steps.
+ *
+ * A snapshot is torn if it is not one of the states (pulses, time) the meter went through during the
+ * read. The sequence lock must give no torn snapshot; the naive copy without it is run the same way to
+ * show that the test does catch tearing. The 8 bit sequence of the lock is not tested for 256 interrupts
+ * within one read, which the main loop cannot take that long for.
+ *
+ * Build and run from the library folder:
+ *
+ *     g++ -std=gnu++11 -Wall -DARDUINO=10805 -Iextras/host -Isrc extras/host/SnapshotStress.cpp src/FlowMeter.cpp -o SnapshotStress
+ *     ./SnapshotStress
+ *
+ * The exit status is 0 when the test passes.
+ */
+
+#include <stdio.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "FlowMeter.h"
+
+unsigned long hostMicros = 0;
+uint8_t SREG = 0;
+
+#define MAX_INTERRUPTS 3                          //!< interrupts per read, at most
+#define PASSES 3                                  //!< reader passes the interrupts are spread over
+
+/**
+ * The meter under test, with the reader as single steps. Each step is one load, as the AVR does it.
+ */
+class SteppedMeter : public FlowMeter {
+  public:
+    SteppedMeter() : FlowMeter(3, UncalibratedSensor) {}
+
+    static const unsigned int bytes = sizeof(unsigned long);                //!< bytes per member
+    static const unsigned int steps = 2 * bytes + 2;                        //!< steps of a pass of getSnapshot()
+
+    /** Sets the counter state, as if count() had run that often. */
+    void set(unsigned long pulses, unsigned long time, unsigned char sequence) {
+        this->_pulses = pulses;
+        this->_pulseTime = time;
+        this->_sequence = sequence;
+    }
+
+    /** The current counter state, atomic (no interrupt runs meanwhile on the host). */
+    FlowPulseSnapshot state() {
+        FlowPulseSnapshot snapshot = {this->_pulses, this->_pulseTime};
+        return snapshot;
+    }
+
+    /** Starts a read. */
+    void start(bool locked, bool descending) {
+        this->_locked = locked;
+        this->_descending = descending;
+        this->_step = locked ? 0 : 1;                                       //!< the naive copy loads no sequence
+        this->_read.pulses = 0;
+        this->_read.time = 0;
+    }
+
+    /** Runs the next load of the read. Returns true when the read is done, the snapshot in read(). */
+    bool step() {
+        if (this->_step == 0) {
+            this->_readSequence = this->_sequence;
+        } else if (this->_step <= 2 * bytes) {
+            unsigned int member = (this->_step - 1) / bytes;                //!< 0: _pulses, 1: _pulseTime
+            unsigned int byte = (this->_step - 1) % bytes;
+            if (this->_descending) {
+                byte = bytes - 1 - byte;
+            }
+            volatile unsigned long *from = member ? &this->_pulseTime : &this->_pulses;
+            unsigned long *to = member ? &this->_read.time : &this->_read.pulses;
+            ((unsigned char *)to)[byte] = ((volatile unsigned char *)from)[byte];
+        } else {
+            if (this->_readSequence == this->_sequence) {
+                return true;
+            }
+            this->_step = 0;                                                //!< the sequence has changed, retry
+            return false;
+        }
+        this->_step++;
+        if (!this->_locked && this->_step > 2 * bytes) {
+            return true;
+        }
+        return false;
+    }
+
+    FlowPulseSnapshot read() {
+        return this->_read;
+    }
+
+  protected:
+    bool _locked = true;                          //!< with the sequence lock (getSnapshot), or the naive copy
+    bool _descending = false;                     //!< byte order of the loads
+    unsigned int _step = 0;                       //!< next load
+    unsigned char _readSequence = 0;              //!< the sequence at the start of the pass
+    FlowPulseSnapshot _read;                      //!< the snapshot being read
+};
+
+SteppedMeter Meter;
+
+/** A start state of the meter and the time between the interrupts. */
+typedef struct {
+    unsigned long pulses;
+    unsigned long time;
+    unsigned long timeStep;
+} Scenario;
+
+const Scenario Scenarios[] = {
+    {0x000000FFUL, 0x000000F0UL, 1},
+    {0x0000FFFFUL, 0x0000FFFEUL, 1},
+    {0x00FFFFFFUL, 0x00FFFFFFUL, 1},
+    {0xFFFFFFFFUL, 0xFFFFFFFEUL, 1},
+    {0x000000FFUL, 0x00000000UL, 0x01010101UL},
+    {0x00FFFFFEUL, 0xFEFEFEFEUL, 0x01010101UL},
+};
+
+const unsigned char Sequences[] = {0, 0xFE, 0xFF};                          //!< sequence at the start, about to wrap
+
+typedef struct {
+    unsigned long reads;
+    unsigned long torn;
+} Result;
+
+/** Runs one read with count() before the steps in schedule (sorted), returns false if it tore. */
+bool readOnce(const Scenario &scenario, unsigned char sequence, bool locked, bool descending,
+              const std::vector<unsigned int> &schedule) {
+    std::vector<FlowPulseSnapshot> states;
+    unsigned int next = 0;
+
+    hostMicros = scenario.time;
+    Meter.set(scenario.pulses, scenario.time, sequence);
+    states.push_back(Meter.state());
+    Meter.start(locked, descending);
+
+    for (unsigned int step = 0; ; step++) {
+        while (next < schedule.size() && schedule[next] == step) {
+            hostMicros += scenario.timeStep;
+            Meter.count();                                                  //!< the interrupt hits before this load
+            states.push_back(Meter.state());
+            next++;
+        }
+        if (Meter.step()) {
+            break;
+        }
+    }
+
+    FlowPulseSnapshot snapshot = Meter.read();
+    for (unsigned int i = 0; i < states.size(); i++) {
+        if (snapshot.pulses == states[i].pulses && snapshot.time == states[i].time) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Runs every schedule of up to interrupts interrupts at steps from first on. */
+void schedules(std::vector<unsigned int> &schedule, unsigned int first, unsigned int interrupts,
+               bool locked, Result &result) {
+    for (unsigned int s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++) {
+        for (unsigned int q = 0; q < sizeof(Sequences); q++) {
+            for (unsigned int descending = 0; descending < 2; descending++) {
+                result.reads++;
+                if (!readOnce(Scenarios[s], Sequences[q], locked, descending, schedule)) {
+                    result.torn++;
+                }
+            }
+        }
+    }
+    if (interrupts == 0) {
+        return;
+    }
+    for (unsigned int step = first; step < PASSES * SteppedMeter::steps; step++) {
+        schedule.push_back(step);
+        schedules(schedule, step, interrupts - 1, locked, result);         //!< same step again allowed
+        schedule.pop_back();
+    }
+}
+
+Result stress(bool locked) {
+    Result result = {0, 0};
+    std::vector<unsigned int> schedule;
+
+    schedules(schedule, 0, MAX_INTERRUPTS, locked, result);
+    printf("%s %lu reads, %lu torn\n", locked ? "seqlock:" : "naive:  ", result.reads, result.torn);
+    return result;
+}
+
+int main() {
+    /* without interrupts, the stepped reader must read what getSnapshot() reads */
+    for (unsigned int s = 0; s < sizeof(Scenarios) / sizeof(Scenarios[0]); s++) {
+        Meter.set(Scenarios[s].pulses, Scenarios[s].time, 0);
+        FlowPulseSnapshot expected = Meter.getSnapshot();
+        Meter.start(true, false);
+        while (!Meter.step()) {
+        }
+        if (Meter.read().pulses != expected.pulses || Meter.read().time != expected.time) {
+            printf("stepped reader differs from getSnapshot()\nFAIL\n");
+            return 1;
+        }
+    }
+
+    Result locked = stress(true);
+    Result naive = stress(false);
+
+    bool pass = locked.torn == 0 && naive.torn > 0;                         //!< the naive copy shows the test works
+    printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+/*
+ * avr-libc stub for host tests of the library: the host has a single address space.
+ */
+
+#ifndef PGMSPACE_HOST_STUB_H
+#define PGMSPACE_HOST_STUB_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#endif   // PGMSPACE_HOST_STUB_H
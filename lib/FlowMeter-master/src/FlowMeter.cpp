@@ -10,70 +10,274 @@
 #endif
 
 #include "FlowMeter.h"                                                      // https://github.com/sekdiy/FlowMeter
-#include <math.h>
+#include <avr/pgmspace.h>
 
 FlowMeter::FlowMeter(unsigned int pin, FlowSensorProperties prop) :
     _pin(pin),                                                              //!< store pin number
     _properties(prop)                                                       //!< store sensor properties
 {
   pinMode(pin, INPUT_PULLUP);                                               //!< initialize interrupt pin as input with pullup
+
+  /* the only floating point: µl per pulse = 1e6 µl/l / (60 s/min * K), and the meter factors, in Q16 */
+  this->_ulPerPulse = min(1000000.0f / (60.0f * prop.kFactor) * 65536.0f + 0.5f, 4294967040.0f);
+  for (unsigned int i = 0; i < 10; i++) {
+    this->_mFactor[i] = prop.mFactor[i] * 65536.0f + 0.5f;
+  }
+  this->_decileMilliHz = prop.capacity * prop.kFactor * 100.0f;            //!< full scale (capacity * K) / 10, in 1/1000 s
+  if (this->_decileMilliHz == 0) {
+    this->_decileMilliHz = 1;
+  }
+}
+
+/**
+ * a * 1000 / b without overflowing 32 bits (b < 4294967)
+ */
+static unsigned long mulDiv1000(unsigned long a, unsigned long b) {
+    return (a / b) * 1000 + (a % b) * 1000 / b;
+}
+
+/**
+ * a * b >> 16 without overflowing 32 bits (the result has to fit)
+ */
+static unsigned long mulQ16(unsigned long a, unsigned long b) {
+    return (a >> 16) * b + (((a & 0xFFFF) * b) >> 16);
+}
+
+void FlowMeter::setCalibration(const FlowCalibrationPoint *curve, unsigned char points) {
+    this->_curve = points ? curve : 0;
+    this->_curvePoints = points;
+}
+
+void FlowMeter::getCalibrationPoint(unsigned char i, unsigned long &frequency, unsigned long &mFactor) {
+    if (this->_curve) {
+        frequency = pgm_read_dword(&this->_curve[i].frequency);
+        mFactor = pgm_read_dword(&this->_curve[i].mFactor);
+    } else {
+        frequency = this->_decileMilliHz * i + this->_decileMilliHz / 2;   //!< centre of the decile
+        mFactor = this->_mFactor[i];
+    }
+}
+
+unsigned long FlowMeter::getMeterFactor(unsigned long frequency) {
+    unsigned char points = this->_curve ? this->_curvePoints : 10;
+    unsigned long f0 = 0, m0 = 0, f1, m1;
+
+    /* first breakpoint at or above the frequency */
+    unsigned char i = 0;
+    for (; i < points; i++) {
+        this->getCalibrationPoint(i, f1, m1);
+        if (f1 >= frequency) {
+            break;
+        }
+        f0 = f1;
+        m0 = m1;
+    }
+    if (i == 0) {
+        return m1;                                                          //!< below the curve
+    }
+    if (i == points) {
+        return m0;                                                          //!< above the curve
+    }
+
+    /* linear interpolation, the span scaled to 16 bits so that the product fits in 32 */
+    unsigned long span = f1 - f0;
+    unsigned long offset = frequency - f0;
+    while (span > 0xFFFF) {
+        span >>= 1;
+        offset >>= 1;
+    }
+    if (m1 >= m0) {
+        return m0 + (min(m1 - m0, 0xFFFFUL) * offset) / span;
+    }
+    return m0 - (min(m0 - m1, 0xFFFFUL) * offset) / span;
 }
 
 double FlowMeter::getCurrentFlowrate() {
-    return this->_currentFlowrate;                                          //!< in l/min
+    return this->_currentFlowrate * 0.00006f;                               //!< in l/min (µl/s * 60 / 1000000)
 }
 
 double FlowMeter::getCurrentVolume() {
-    return this->_currentVolume;                                            //!< in l
+    return this->_currentVolume / 1000000.0f;                               //!< in l
 }
 
 double FlowMeter::getTotalFlowrate() {
-    return this->_totalVolume / (this->_totalDuration / 1000.0f) * 60.0f;   //!< in l/min
+    return this->getTotalVolume() / (this->_totalDuration / 1000.0f) * 60.0f;   //!< in l/min
 }
 
 double FlowMeter::getTotalVolume() {
-    return this->_totalVolume;                                              //!< in l
+    return this->_totalVolume / 1000.0f + this->_totalVolumeRemainder / 1000000.0f;  //!< in l
+}
+
+unsigned int FlowMeter::getCurrentFlowMlps() {
+    return min((this->_currentFlowrate + 500) / 1000, 65535UL);             //!< in ml/s, rounded
+}
+
+unsigned long FlowMeter::getCurrentFlowUlps() {
+    return this->_currentFlowrate;                                          //!< in µl/s
+}
+
+unsigned long FlowMeter::getCurrentVolumeUl() {
+    return this->_currentVolume;                                            //!< in µl
+}
+
+unsigned long FlowMeter::getTotalVolumeMl() {
+    return this->_totalVolume;                                              //!< in ml
 }
 
 void FlowMeter::tick(unsigned long duration) {
-    /* sampling and normalisation */
-    double seconds = duration / 1000.0f;                                    //!< normalised duration (in s, i.e. per 1000ms)
-    cli();                                                                  //!< going to change interrupt variable(s)
-    double frequency = this->_currentPulses / seconds;                      //!< normalised frequency (in 1/s)
-    this->_currentPulses = 0;                                               //!< reset pulse counter after successfull sampling
-    sei();                                                                  //!< done changing interrupt variable(s)
-
-    /* determine current correction factor (from sensor properties) */
-    unsigned int decile = floor(10.0f * frequency / (this->_properties.capacity * this->_properties.kFactor));          //!< decile of current flow relative to sensor capacity
-    unsigned int ceiling =  9;                                                                                          //!< highest possible decile index
-    this->_currentCorrection = this->_properties.kFactor / this->_properties.mFactor[min(decile, ceiling)];             //!< combine constant k-factor and m-factor for decile
+    if (duration == 0) {
+        duration = 1;                                                       //!< avoid the division, the pulses are still counted
+    }
+
+    /* sampling */
+    unsigned long pulses = this->takePulses();                              //!< pulses since the last tick
+    unsigned long period = this->takePeriod(pulses, duration);              //!< mean pulse period (in µs), 0: count pulses
+    unsigned long frequency = period ? 1000000000UL / period                //!< normalised frequency (in 1/1000 s)
+                                     : pulses * 1000000UL / duration;
+
+    /* determine current correction factor (from the calibration curve) */
+    this->_currentMeterFactor = this->getMeterFactor(frequency);            //!< interpolated m-factor (Q16)
+    unsigned long perPulse = mulQ16(this->_ulPerPulse, this->_currentMeterFactor);   //!< combine k-factor and m-factor (in µl, Q16)
 
     /* update current calculations: */
-    this->_currentFlowrate = frequency / this->_currentCorrection;          //!< get flow rate (in l/min) from normalised frequency and combined correction factor
-    this->_currentVolume = this->_currentFlowrate / (60.0f/seconds);        //!< get volume (in l) from normalised flow rate and normalised time
+    unsigned long fraction = pulses * (perPulse & 0xFFFF) + this->_currentVolumeFraction;
+    this->_currentVolume = pulses * (perPulse >> 16) + (fraction >> 16);    //!< volume (in µl) from pulses and combined correction factor
+    this->_currentVolumeFraction = fraction & 0xFFFF;                       //!< carry the part below 1 µl
+    if (period) {
+        unsigned long nlPerPulse = (perPulse >> 16) * 1000 + (((perPulse & 0xFFFF) * 1000) >> 16);
+        this->_currentFlowrate = mulDiv1000(nlPerPulse, period);            //!< flow rate (in µl/s) from the pulse period
+    } else {
+        this->_currentFlowrate = mulDiv1000(this->_currentVolume, duration);   //!< flow rate (in µl/s) from the pulse count
+    }
+
+    this->setStopGap(frequency);                                            //!< rearm the watchdog for this pulse rate
+
+    /* ±1 pulse, or the timing resolution of the period */
+    this->_currentPrecision = period ? this->_periodPrecision : 1000000UL / max(pulses, 1UL);
 
     /* update statistics: */
     this->_currentDuration = duration;                                      //!< store current tick duration (convenience, in ms)
-    this->_currentFrequency = frequency;                                    //!< store current pulses per second (convenience, in 1/s)
+    this->_currentFrequency = frequency;                                    //!< store current pulses per second (convenience, in 1/1000 s)
     this->_totalDuration += duration;                                       //!< accumulate total duration (in ms)
-    this->_totalVolume += this->_currentVolume;                             //!< accumulate total volume (in l)
-    this->_totalCorrection += this->_currentCorrection * duration;          //!< accumulate corrections over time
+    this->_totalVolumeRemainder += this->_currentVolume % 1000;             //!< accumulate total volume (in ml, and µl below 1 ml)
+    this->_totalVolume += this->_currentVolume / 1000 + this->_totalVolumeRemainder / 1000;
+    this->_totalVolumeRemainder %= 1000;
+    this->_totalCorrection += duration * 1024 / max(this->_currentMeterFactor >> 6, 1UL);   //!< accumulate duration / m-factor
+}
+
+void FlowMeter::setGate(unsigned long pulses, unsigned long maxDuration, unsigned long minDuration) {
+    this->_gatePulses = max(pulses, 1UL);
+    this->_gateMax = maxDuration;
+    this->_gateMin = min(minDuration, maxDuration);
+}
+
+bool FlowMeter::update(unsigned long now) {
+    unsigned long elapsed = now - this->_gateStart;
+
+    if (elapsed < this->_gateMin) {
+        return false;                                                       //!< too short, whatever the pulses
+    }
+    if (elapsed < this->_gateMax && this->getPendingPulses() < this->_gatePulses) {
+        return false;                                                       //!< not precise enough yet, still within the latency bound
+    }
+    this->tick(elapsed);
+    this->_gateStart = now;
+    return true;
+}
+
+unsigned long FlowMeter::getPendingPulses() {
+    return this->getSnapshot().pulses - this->_takenPulses;
+}
+
+void FlowMeter::setStopDetection(unsigned char periods, unsigned long minGap) {
+    this->_stopPeriods = periods;
+    this->_stopMinGap = minGap;
+    this->setStopGap(this->_currentFrequency);
+}
+
+void FlowMeter::setStopGap(unsigned long frequency) {
+    unsigned long gap = 0;                                                  //!< disarmed: disabled, or no flow to lose
+
+    if (this->_stopPeriods && frequency) {
+        unsigned long period = 1000000000UL / frequency;                    //!< expected pulse period (in µs)
+        gap = period > 0x7FFFFFFFUL / this->_stopPeriods ? 0x7FFFFFFFUL     //!< within half the range of the µs clock
+                                                          : period * this->_stopPeriods;
+        gap = max(gap, this->_stopMinGap);
+    }
+
+    uint8_t sreg = SREG;
+    cli();                                                                  //!< checkFlow() must not see half of it
+    this->_stopGap = gap;
+    SREG = sreg;
+}
+
+bool FlowMeter::checkFlow() {
+    FlowPulseSnapshot snapshot = this->getSnapshot();
+    unsigned long now = this->getClock();                                   //!< after the snapshot, never before its timestamp
+
+    if (snapshot.pulses != this->_watchPulses) {
+        this->_watchPulses = snapshot.pulses;
+        this->_watchTime = snapshot.time ? snapshot.time : now;             //!< 0: the backend does not timestamp the pulses
+        this->_flowStopped = false;
+        return false;
+    }
+    if (this->_flowStopped || this->_stopGap == 0 || now - this->_watchTime <= this->_stopGap) {
+        return false;                                                       //!< wraps correctly
+    }
+    this->_flowStopped = true;
+    return true;
+}
+
+bool FlowMeter::isFlowStopped() {
+    return this->_flowStopped;
+}
+
+unsigned long FlowMeter::getClock() {
+    return micros();                                                        //!< the clock of count()
 }
 
 void FlowMeter::count() {
-    this->_currentPulses++;                                                 //!< this should be called from an interrupt service routine
+    this->_pulses++;                                                        //!< this should be called from an interrupt service routine
+    this->_pulseTime = micros();
+    this->_sequence++;                                                      //!< publish: readers that started before retry
+}
+
+FlowPulseSnapshot FlowMeter::getSnapshot() {
+    FlowPulseSnapshot snapshot;
+    unsigned char sequence;
+
+    do {
+        sequence = this->_sequence;
+        snapshot.pulses = this->_pulses;                                    //!< may be torn by count() ...
+        snapshot.time = this->_pulseTime;
+    } while (sequence != this->_sequence);                                  //!< ... then the sequence has changed
+    return snapshot;
+}
+
+unsigned long FlowMeter::takePulses() {
+    unsigned long counter = this->getSnapshot().pulses;
+    unsigned long pulses = counter - this->_takenPulses;                    //!< wraps correctly
+    this->_takenPulses = counter;
+    return pulses;
+}
+
+unsigned long FlowMeter::takePeriod(unsigned long, unsigned long) {
+    return 0;                                                               //!< no timestamps, count the pulses
 }
 
 void FlowMeter::reset() {
-    cli();                                                                  //!< going to change interrupt variable(s)
-    this->_currentPulses = 0;                                               //!< reset pulse counter
-    sei();                                                                  //!< done changing interrupt variable(s)
+    this->takePulses();                                                     //!< discard the pulses counted so far
 
-    this->_currentFrequency = 0.0f;
-    this->_currentDuration = 0.0f;
-    this->_currentFlowrate = 0.0f;
-    this->_currentVolume = 0.0f;
-    this->_currentCorrection = 0.0f;
+    this->_currentFrequency = 0;
+    this->_currentDuration = 0;
+    this->_currentFlowrate = 0;
+    this->_currentVolume = 0;
+    this->_currentMeterFactor = 65536;
+    this->_currentVolumeFraction = 0;
+    this->_currentPrecision = 1000000;
+    this->_gateStart = millis();                                            //!< a new measurement window starts now
+    this->setStopGap(0);                                                    //!< no flow measured yet
+    this->_flowStopped = false;
 }
 
 unsigned int FlowMeter::getPin() {
@@ -85,14 +289,18 @@ unsigned long FlowMeter::getCurrentDuration() {
 }
 
 double FlowMeter::getCurrentFrequency() {
-    return this->_currentFrequency;                                         //!< in 1/s
+    return this->_currentFrequency / 1000.0f;                               //!< in 1/s
 }
 
 double FlowMeter::getCurrentError() {
     /// error (in %) = error * 100
     /// error = correction rate - 1
-    /// correction rate = k-factor / correction
-    return (this->_properties.kFactor / this->_currentCorrection - 1) * 100;  //!< in %
+    /// correction rate = k-factor / correction = m-factor
+    return (this->_currentMeterFactor / 65536.0f - 1) * 100;                //!< in %
+}
+
+unsigned long FlowMeter::getCurrentPrecision() {
+    return this->_currentPrecision;                                         //!< in ppm
 }
 
 unsigned long FlowMeter::getTotalDuration() {
@@ -102,8 +310,11 @@ unsigned long FlowMeter::getTotalDuration() {
 double FlowMeter::getTotalError() {
     /// average error (in %) = average error * 100
     /// average error = average correction rate - 1
-    /// average correction rate = k-factor / corrections over time * total time
-    return (this->_properties.kFactor / this->_totalCorrection * this->_totalDuration - 1) * 100;
+    /// average correction rate = total time / (time / m-factor, accumulated)
+    if (this->_totalCorrection == 0) {
+        return 0.0f;
+    }
+    return ((double)this->_totalDuration / this->_totalCorrection - 1) * 100;
 }
 
 FlowSensorProperties UncalibratedSensor = {60.0f, 5.0f, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
@@ -36,6 +36,39 @@ typedef struct {
   double mFactor[10];   //!< multiplicative correction factor near unity, "meter factor" (per decile of flow)
 } FlowSensorProperties;
 
+/**
+ * FlowCalibrationPoint
+ *
+ * One breakpoint of a piecewise linear calibration curve (see FlowMeter::setCalibration).
+ * Curves live in PROGMEM, sorted by frequency, with any number of points:
+ *
+ *     const FlowCalibrationPoint MyCurve[] PROGMEM = {
+ *       {FLOW_MILLIHZ(2.0), FLOW_Q16(1.15)},
+ *       {FLOW_MILLIHZ(30.0), FLOW_Q16(1.0)},
+ *       {FLOW_MILLIHZ(250.0), FLOW_Q16(0.85)}
+ *     };
+ *
+ * The meter factor is interpolated linearly between the points and held constant beyond the ends.
+ */
+typedef struct {
+  unsigned long frequency;  //!< pulse rate at the breakpoint (in 1/1000 s)
+  unsigned long mFactor;    //!< meter factor at the breakpoint (Q16, 65536 = 1.0)
+} FlowCalibrationPoint;
+
+/**
+ * FlowPulseSnapshot
+ *
+ * A consistent copy of the pulse counter and the time of the last pulse, taken without disabling interrupts
+ * (see FlowMeter::getSnapshot).
+ */
+typedef struct {
+  unsigned long pulses;     //!< pulses since the start (free running, wraps)
+  unsigned long time;       //!< time of the last pulse (in µs like micros(), wraps; 0 if the backend has no timestamps)
+} FlowPulseSnapshot;
+
+#define FLOW_MILLIHZ(hz) ((unsigned long)((hz) * 1000.0 + 0.5))   //!< pulse rate in 1/s to 1/1000 s, at compile time
+#define FLOW_Q16(x) ((unsigned long)((x) * 65536.0 + 0.5))        //!< factor to Q16, at compile time
+
 extern FlowSensorProperties UncalibratedSensor; //!< default sensor
 extern FlowSensorProperties FS300A;             //!< see documentation about FS300A/SEN02141B
 extern FlowSensorProperties FS400A;             //!< see documentation about FS400A/USN-HS10TA
@@ -53,6 +86,11 @@ class FlowMeter {
     double getCurrentFlowrate();                  //!< Returns the current flow rate since last reset (in l/min).
     double getCurrentVolume();                    //!< Returns the current volume since last reset (in l).
 
+    unsigned int getCurrentFlowMlps();            //!< Returns the current flow rate (in ml/s, integer, no float math).
+    unsigned long getCurrentFlowUlps();           //!< Returns the current flow rate (in µl/s, integer, no float math).
+    unsigned long getCurrentVolumeUl();           //!< Returns the volume of the current tick (in µl).
+    unsigned long getTotalVolumeMl();             //!< Returns the total volume of this flow meter instance (in ml).
+
     double getTotalFlowrate();                    //!< Returns the (linear) average flow rate in this flow meter instance (in l/min).
     double getTotalVolume();                      //!< Returns the total volume flown trough this flow meter instance (in l).
 
@@ -82,10 +120,60 @@ class FlowMeter {
      * In these cases the unit of measure has to be converted accordingly (e.g. from gal/s to l/min).
      * See file G34_Flow_rate_to_frequency.jpg for reference.
      *
+     * The calculation is done in integers: the constructor turns K into its reciprocal, the volume
+     * per pulse in Q16 microlitres, and the meter factor m is interpolated from the calibration curve
+     * at the current pulse rate, so a tick is
+     *
+     * v = 1e6 / (60 * K) * m           | units: µl per pulse (Q16)
+     * V = p * v                        | units: µl, the fraction carried to the next tick
+     * Q = V / t                        | units: µl/ms = ml/s (kept in µl/s)
+     *
+     * with multiplications and two divisions only, and the double getters convert from these on demand.
+     * At most 4294 pulses per tick (e.g. 4.2 kHz for 1 s ticks), v below 65536 µl.
+     *
+     * Backends that timestamp the pulses (see FlowMeterCapture) may return the mean pulse period T instead,
+     * then f = 1 / T and Q = µl per pulse / T, which resolves low flows far better than p / t.
+     *
      * @param duration The tick duration (in ms).
      */
     void tick(unsigned long duration = 1000);
+
+    /**
+     * Adaptive gate: instead of ticking at a fixed period, call update() often and let the measurement
+     * window end when it holds enough pulses for the wanted precision (±1 pulse in pulses), or when it
+     * reaches the longest tolerated latency, whichever comes first. High flows then update quickly,
+     * low flows wait for a usable count. Each result carries its own duration (getCurrentDuration) and
+     * precision estimate (getCurrentPrecision).
+     *
+     * The default gate never closes on pulses and lasts 1000 ms, i.e. a fixed 1 s tick.
+     *
+     * @param pulses Pulses that close the window (e.g. 100 for 1 %).
+     * @param maxDuration Longest window (in ms).
+     * @param minDuration Shortest window (in ms).
+     */
+    void setGate(unsigned long pulses, unsigned long maxDuration, unsigned long minDuration = 0);
+    bool update(unsigned long now);               //!< Ticks if the gate closes at now (millis()). Returns true if it ticked.
+    unsigned long getPendingPulses();             //!< Returns the pulses since the last tick.
+
+    /**
+     * Flow stop watchdog: checkFlow() is meant to be called from a periodic timer interrupt (e.g. every
+     * millisecond) and compares the time since the last pulse with the pulse period expected from the last
+     * tick. Once the gap exceeds periods times that period (and at least minGap), the flow counts as
+     * stopped, without waiting for the end of the measurement window. The next pulse clears it.
+     *
+     * The gap is measured from the timestamp of the last pulse where the backend records one (count()
+     * stamps it in the interrupt), otherwise from the check that first saw it. No stop is reported before
+     * the first tick with flow, nor while the last tick measured none.
+     *
+     * @param periods Expected pulse periods without a pulse that mean stopped, 0 disables the watchdog.
+     * @param minGap Shortest gap that means stopped (in µs), against timing jitter at high pulse rates.
+     */
+    void setStopDetection(unsigned char periods, unsigned long minGap = 0);
+    bool checkFlow();                             //!< Updates the watchdog. Returns true once, when the flow stops. Interrupt context.
+    bool isFlowStopped();                         //!< Returns true from the detected stop to the next pulse.
+    virtual unsigned long getClock();             //!< Returns the current time in the clock of getSnapshot().time (in µs).
     void count();                                 //!< Increments the internal pulse counter. Serves as an interrupt callback routine.
+    virtual FlowPulseSnapshot getSnapshot();      //!< Returns the pulse counter and the time of the last pulse, read without disabling interrupts.
     void reset();                                 //!< Prepares the flow meter for a fresh measurement. Resets all current values.
 
     /*
@@ -96,25 +184,83 @@ class FlowMeter {
     unsigned long getCurrentDuration();           //!< Returns the duration of the current tick (in ms).
     double getCurrentFrequency();                 //!< Returns the pulse rate in the current tick (in 1/s).
     double getCurrentError();                     //!< Returns the error resulting from the current measurement (in %).
+    unsigned long getCurrentPrecision();          //!< Returns the uncertainty of the current flow rate (in ppm: ±1 pulse, or ±1 timestamp step over the measured pulses).
 
     unsigned long getTotalDuration();             //!< Returns the total run time of this flow meter instance (in ms).
     double getTotalError();                       //!< Returns the (linear) average error of this flow meter instance (in %).
 
+    /**
+     * Replaces the meter factors of the sensor properties by a piecewise linear curve in PROGMEM.
+     * Without a curve the ten meter factors are interpolated between the centres of their deciles.
+     */
+    void setCalibration(const FlowCalibrationPoint *curve, unsigned char points);
+    unsigned long getMeterFactor(unsigned long frequency);   //!< Returns the interpolated meter factor for a pulse rate in 1/1000 s (Q16).
+
   protected:
+    /**
+     * Pulse counting backend: returns the pulses since the previous call.
+     *
+     * The default takes the difference of two snapshots (getSnapshot), so any backend that provides a free
+     * running counter there works. The default counter is count(), called from an interrupt service routine
+     * for every pulse; subclasses count elsewhere (e.g. a hardware counter, see FlowMeterCounter).
+     */
+    virtual unsigned long takePulses();
+
+    /**
+     * Pulse period backend: returns the mean period of the pulses just taken (in µs), or 0 to compute the
+     * flow rate from the pulse count instead (default). Backends returning a period also set _periodPrecision.
+     */
+    virtual unsigned long takePeriod(unsigned long pulses, unsigned long duration);
+
     unsigned int _pin;                            //!< connection pin (has to be interrupt capable!)
     FlowSensorProperties _properties;             //!< sensor properties (including calibration data)
 
-    unsigned long _currentDuration;               //!< current tick duration (convenience, in ms)
-    double _currentFrequency;                     //!< current pulses per second (convenience, in 1/s)
-    double _currentFlowrate = 0.0f;               //!< current flow rate (in l/tick), e.g.: 1 l / min = 1 pulse / s / (pulses / s / l / min)
-    double _currentVolume = 0.0f;                 //!< current volume (in l), e.g.: 1 l = 1 (l / min) / (60 * s)
-    double _currentCorrection;                    //!< currently applied correction factor
+    unsigned long _ulPerPulse;                    //!< volume per pulse with the k-factor alone (in µl, Q16)
+    unsigned long _mFactor[10];                   //!< meter factors of the sensor properties (Q16)
+    unsigned long _decileMilliHz;                 //!< pulse rate of one decile of the sensor capacity (in 1/1000 s)
+    const FlowCalibrationPoint *_curve = 0;       //!< calibration curve in PROGMEM, replaces _mFactor
+    unsigned char _curvePoints = 0;
+
+    void getCalibrationPoint(unsigned char i, unsigned long &frequency, unsigned long &mFactor);
+
+    unsigned long _currentDuration = 0;           //!< current tick duration (convenience, in ms)
+    unsigned long _currentFrequency = 0;          //!< current pulses per second (convenience, in 1/1000 s)
+    unsigned long _currentFlowrate = 0;           //!< current flow rate (in µl/s)
+    unsigned long _currentVolume = 0;             //!< current volume (in µl)
+    unsigned long _currentMeterFactor = 65536;    //!< currently applied meter factor (Q16)
+    unsigned long _currentPrecision = 1000000;    //!< uncertainty of the current flow rate (in ppm)
+    unsigned long _periodPrecision = 1000000;     //!< uncertainty of the period returned by takePeriod() (in ppm)
 
-    unsigned long _totalDuration = 0.0f;          //!< total measured duration since begin of measurement (in ms)
-    double _totalVolume = 0.0f;                   //!< total volume since begin of measurement (in l)
-    double _totalCorrection = 0.0f;               //!< accumulated correction factors
+    unsigned long _gatePulses = 0xFFFFFFFF;       //!< pulses that close the measurement window
+    unsigned long _gateMax = 1000;                //!< longest measurement window (in ms)
+    unsigned long _gateMin = 0;                   //!< shortest measurement window (in ms)
+    unsigned long _gateStart = 0;                 //!< start of the current measurement window (in ms)
+    unsigned int _currentVolumeFraction = 0;      //!< volume below 1 µl carried to the next tick (Q16)
 
-    volatile unsigned long _currentPulses = 0;    //!< pulses within current sample period
+    unsigned char _stopPeriods = 0;               //!< expected pulse periods without a pulse that mean stopped, 0: disabled
+    unsigned long _stopMinGap = 0;                //!< shortest gap that means stopped (in µs)
+    volatile unsigned long _stopGap = 0;          //!< gap that means stopped for the last tick (in µs), 0: disarmed; read by checkFlow()
+    unsigned long _watchPulses = 0;               //!< pulse counter at the previous checkFlow()
+    unsigned long _watchTime = 0;                 //!< time of the last pulse seen by checkFlow() (in µs)
+    volatile bool _flowStopped = false;           //!< set by checkFlow(), cleared by the next pulse
+
+    void setStopGap(unsigned long frequency);
+
+    unsigned long _totalDuration = 0;             //!< total measured duration since begin of measurement (in ms)
+    unsigned long _totalVolume = 0;               //!< total volume since begin of measurement (in ml)
+    unsigned int _totalVolumeRemainder = 0;       //!< total volume below 1 ml (in µl)
+    unsigned long _totalCorrection = 0;           //!< accumulated duration divided by the applied meter factors (in ms)
+
+    /**
+     * Written by count() in the interrupt, read by getSnapshot() in the main loop as a sequence lock:
+     * the interrupt increments _sequence after every update, the reader copies both values and
+     * retries if _sequence changed meanwhile. Interrupts are never disabled, and a single byte
+     * sequence is enough because the main loop cannot interrupt an update.
+     */
+    volatile unsigned long _pulses = 0;           //!< pulses since the start (free running)
+    volatile unsigned long _pulseTime = 0;        //!< time of the last pulse (in µs)
+    volatile unsigned char _sequence = 0;         //!< incremented after every update of _pulses and _pulseTime
+    unsigned long _takenPulses = 0;               //!< _pulses at the previous takePulses()
 };
 
 /**
@@ -0,0 +1,147 @@
+/*
+ * Flow Meter, input capture backend
+ */
+
+#include "Arduino.h"
+#include "FlowMeterCapture.h"
+#include "FlowMeterTimer1.h"
+#include <avr/interrupt.h>
+
+// Timer1: input capture noise canceler, falling edge (ICES1 = 0), clock select (CS12:0) 011: clk / 64
+#define FLOWMETER_CAPTURE_CLOCK (_BV(ICNC1) | _BV(CS11) | _BV(CS10))
+
+static volatile unsigned long capturePulses = 0;  //!< pulses captured (free running, wraps)
+static volatile unsigned long captureStamp = 0;   //!< timestamp of the last pulse (in timer ticks)
+
+/**
+ * 32 bit timer value from the 16 bit register, the overflows and the overflow flag read with it.
+ * A pending overflow belongs to values taken after it, i.e. the low ones.
+ */
+static inline unsigned long captureExtend(uint16_t low, uint16_t high, uint8_t pending) {
+    if (pending && low < 0x8000) {
+        high++;
+    }
+    return ((unsigned long)high << 16) | low;
+}
+
+ISR(TIMER1_CAPT_vect) {
+    captureStamp = captureExtend(ICR1, flowTimer1Overflows, TIFR1 & _BV(TOV1));   //!< latched by the hardware at the edge
+    capturePulses++;
+    flowTimer1Sequence++;                         //!< publish, see readCapture()
+}
+
+/**
+ * Consistent copy of the pulse counter, the last timestamp and the timer, without disabling interrupts
+ * (except around TCNT1, see flowTimer1Count): the copy is retried if one of the interrupts ran meanwhile.
+ */
+static void readCapture(unsigned long &pulses, unsigned long &stamp, unsigned long &now) {
+    uint8_t sequence;
+    uint16_t low, high;
+    uint8_t pending;
+
+    do {
+        sequence = flowTimer1Sequence;
+        pulses = capturePulses;
+        stamp = captureStamp;
+        low = flowTimer1Count();                  //!< TEMP shared with interrupts that read Timer1
+        high = flowTimer1Overflows;
+        pending = TIFR1 & _BV(TOV1);
+    } while (sequence != flowTimer1Sequence);
+    now = captureExtend(low, high, pending);
+}
+
+FlowMeterCapture::FlowMeterCapture(FlowSensorProperties prop) :
+    FlowMeter(FLOWMETER_CAPTURE_PIN, prop)        //!< ICP1 as input with pullup
+{
+}
+
+void FlowMeterCapture::begin() {
+    pinMode(this->_pin, INPUT_PULLUP);            //!< again, in case the pin was set up after the constructor
+
+    uint8_t sreg = SREG;
+    cli();                                        //!< going to change timer registers and interrupt variable(s)
+    TCCR1B = 0;                                   //!< stop the timer while configuring
+    TCCR1A = 0;                                   //!< normal mode, no compare outputs
+    TCNT1 = 0;
+    flowTimer1Overflows = 0;
+    capturePulses = 0;
+    captureStamp = 0;
+    this->_takenPulses = 0;
+    this->_stamped = false;
+    this->_counting = true;
+    TIFR1 = _BV(ICF1) | _BV(TOV1);                //!< clear pending captures and overflows
+    TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+    TCCR1B = FLOWMETER_CAPTURE_CLOCK;             //!< start timestamping
+    SREG = sreg;                                  //!< done, interrupts as the caller had them
+}
+
+void FlowMeterCapture::end() {
+    TCCR1B = 0;                                   //!< no clock source, the timer stops
+    TIMSK1 = 0;
+}
+
+void FlowMeterCapture::reset() {
+    FlowMeter::reset();
+    this->_stamped = false;                       //!< the next period starts at the next pulse
+    this->_counting = true;
+}
+
+bool FlowMeterCapture::isCounting() {
+    return this->_counting;
+}
+
+FlowPulseSnapshot FlowMeterCapture::getSnapshot() {
+    FlowPulseSnapshot snapshot;
+    unsigned long now;
+
+    readCapture(snapshot.pulses, snapshot.time, now);
+    snapshot.time *= FLOWMETER_CAPTURE_TICK_US;   //!< in µs, wraps like micros()
+    return snapshot;
+}
+
+unsigned long FlowMeterCapture::getClock() {
+    unsigned long pulses, stamp, now;
+
+    readCapture(pulses, stamp, now);
+    return now * FLOWMETER_CAPTURE_TICK_US;
+}
+
+unsigned long FlowMeterCapture::takePulses() {
+    unsigned long count;
+    readCapture(count, this->_stamp, this->_now);  //!< the count, its timestamp and the timer, read together
+
+    unsigned long pulses = count - this->_takenPulses;                      //!< wraps correctly
+    this->_takenPulses = count;
+    return pulses;
+}
+
+unsigned long FlowMeterCapture::takePeriod(unsigned long pulses, unsigned long) {
+    const unsigned long timeout = FLOWMETER_CAPTURE_TIMEOUT / FLOWMETER_CAPTURE_TICK_US;
+
+    if (pulses == 0) {
+        /* no pulse: the period is at least the time since the last one */
+        unsigned long idle = this->_now - this->_lastStamp;
+        if (!this->_stamped || idle > timeout) {
+            this->_counting = true;               //!< no flow (0 pulses counted)
+            return 0;
+        }
+        this->_counting = false;
+        this->_periodPrecision = 1000000UL;       //!< an upper bound only
+        return max(idle * FLOWMETER_CAPTURE_TICK_US, this->_period);
+    }
+
+    unsigned long span = this->_stamp - this->_lastStamp;                   //!< from the last pulse of the previous tick
+    bool stamped = this->_stamped;
+    this->_lastStamp = this->_stamp;
+    this->_stamped = true;
+
+    if (!stamped || span > timeout || pulses >= FLOWMETER_CAPTURE_COUNT_PULSES) {
+        this->_counting = true;                   //!< no reference pulse, or enough pulses to count
+        this->_period = 0;
+        return 0;
+    }
+    this->_counting = false;
+    this->_period = span * FLOWMETER_CAPTURE_TICK_US / pulses;
+    this->_periodPrecision = 1000000UL / max(span, 1UL);                    //!< ±1 timer tick over the span
+    return this->_period;
+}
@@ -0,0 +1,68 @@
+/**
+ * Flow Meter, input capture backend
+ *
+ * The flow sensor drives the input capture pin of Timer/Counter1 (ICP1, Arduino pin 8 on the ATmega328).
+ * Timer1 runs at 250 kHz and latches a 4 µs timestamp of every pulse, so tick() knows the exact span of the
+ * pulses it takes and computes the flow from the mean pulse period instead of the pulse count:
+ *
+ *  - at low flow a 1 s count resolves ±1 pulse (20 % at 5 pulses), the period resolves 4 µs,
+ *  - the rate is known from two pulses, so ticks can be shorter than a second.
+ *
+ * At high flow (at least FLOWMETER_CAPTURE_COUNT_PULSES per tick) it switches back to counting, which is as
+ * precise there. Without pulses the flow decays as 1 / (time since the last pulse) and drops to 0 after
+ * FLOWMETER_CAPTURE_TIMEOUT.
+ *
+ * Timer1 is not available for anything else, including FlowMeterCounter.
+ */
+
+#ifndef FLOWMETERCAPTURE_H
+#define FLOWMETERCAPTURE_H
+
+#include "FlowMeter.h"
+
+#define FLOWMETER_CAPTURE_PIN 8                   //!< ICP1, input capture of Timer/Counter1
+#define FLOWMETER_CAPTURE_TICK_US 4               //!< timestamp resolution (16 MHz / 64)
+
+#ifndef FLOWMETER_CAPTURE_COUNT_PULSES
+#define FLOWMETER_CAPTURE_COUNT_PULSES 64         //!< pulses per tick from which the pulses are counted
+#endif
+
+#ifndef FLOWMETER_CAPTURE_TIMEOUT
+#define FLOWMETER_CAPTURE_TIMEOUT 2000000UL       //!< no pulse for this long means no flow (in µs)
+#endif
+
+/**
+ * FlowMeterCapture
+ *
+ * Usage (instead of attachInterrupt() and count()):
+ *
+ *     FlowMeterCapture Meter = FlowMeterCapture(MySensor);
+ *     Meter.begin();                             // in setup()
+ *     Meter.tick(period);                        // as with FlowMeter, e.g. every 250 ms
+ */
+class FlowMeterCapture : public FlowMeter {
+  public:
+    FlowMeterCapture(FlowSensorProperties prop = UncalibratedSensor   //!< The properties of the actual flow sensor being used (default: UncalibratedSensor).
+                    );                            //!< Initializes a new flow meter object on pin ICP1.
+
+    void begin();                                 //!< Takes over Timer1 and starts timestamping (falling edges, like the interrupt backend).
+    void end();                                   //!< Stops timestamping and releases Timer1.
+    void reset();                                 //!< Prepares the flow meter for a fresh measurement, forgets the last pulse.
+
+    bool isCounting();                            //!< Returns true if the last tick counted pulses, false if it measured their period.
+    FlowPulseSnapshot getSnapshot();              //!< Returns the pulse counter and the timestamp of the last pulse.
+    unsigned long getClock();                     //!< Returns the timer in the clock of the timestamps (in µs).
+
+  protected:
+    unsigned long takePulses();                   //!< Pulses since the last call, and the timestamp of the last one.
+    unsigned long takePeriod(unsigned long pulses, unsigned long duration);   //!< Mean period of those pulses (in µs).
+
+    unsigned long _lastStamp = 0;                 //!< timestamp of the last pulse taken (in timer ticks)
+    unsigned long _stamp = 0;                     //!< timestamp of the last pulse of the current tick (in timer ticks)
+    unsigned long _now = 0;                       //!< timer at the current tick (in timer ticks)
+    unsigned long _period = 0;                    //!< last measured period (in µs, 0: none yet)
+    bool _stamped = false;                        //!< _lastStamp is valid
+    bool _counting = true;                        //!< the last tick counted pulses
+};
+
+#endif   // FLOWMETERCAPTURE_H
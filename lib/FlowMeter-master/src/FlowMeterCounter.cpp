@@ -0,0 +1,58 @@
+/*
+ * Flow Meter, hardware counter backend
+ */
+
+#include "Arduino.h"
+#include "FlowMeterCounter.h"
+#include "FlowMeterTimer1.h"
+#include <avr/interrupt.h>
+
+// Timer1 clock select (CS12:0) 110: external clock on T1, falling edge
+#define FLOWMETER_COUNTER_CLOCK (_BV(CS12) | _BV(CS11))
+
+FlowMeterCounter::FlowMeterCounter(FlowSensorProperties prop) :
+    FlowMeter(FLOWMETER_COUNTER_PIN, prop)        //!< T1 as input with pullup
+{
+}
+
+void FlowMeterCounter::begin() {
+    uint8_t sreg = SREG;
+    cli();                                        //!< going to change timer registers and interrupt variable(s)
+    TCCR1B = 0;                                   //!< stop the timer while configuring
+    TCCR1A = 0;                                   //!< normal mode, no compare outputs
+    TCNT1 = 0;
+    flowTimer1Overflows = 0;
+    this->_takenPulses = 0;
+    TIFR1 = _BV(TOV1);                            //!< clear a pending overflow
+    TIMSK1 = _BV(TOIE1);                          //!< overflow interrupt only
+    TCCR1B = FLOWMETER_COUNTER_CLOCK;             //!< count pulses on T1
+    SREG = sreg;                                  //!< done, interrupts as the caller had them
+}
+
+void FlowMeterCounter::end() {
+    TCCR1B = 0;                                   //!< no clock source, the counter stops
+    TIMSK1 = 0;
+}
+
+unsigned long FlowMeterCounter::getCounter() {
+    uint8_t sequence;
+    uint16_t low, high;
+    uint8_t pending;
+
+    do {                                          //!< TCNT1 and the overflows have to be read together
+        sequence = flowTimer1Sequence;
+        low = flowTimer1Count();                  //!< TEMP shared with interrupts that read Timer1
+        high = flowTimer1Overflows;
+        pending = TIFR1 & _BV(TOV1);
+    } while (sequence != flowTimer1Sequence);     //!< the overflow interrupt ran meanwhile, retry
+
+    if (pending && low < 0x8000) {
+        high++;                                   //!< overflowed, but the interrupt is still pending (interrupts disabled by the caller)
+    }
+    return ((unsigned long)high << 16) | low;
+}
+
+FlowPulseSnapshot FlowMeterCounter::getSnapshot() {
+    FlowPulseSnapshot snapshot = {this->getCounter(), 0};                   //!< the hardware does not timestamp the pulses
+    return snapshot;
+}
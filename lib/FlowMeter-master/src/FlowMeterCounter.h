@@ -0,0 +1,42 @@
+/**
+ * Flow Meter, hardware counter backend
+ *
+ * The flow sensor drives the external clock input of Timer/Counter1 (T1, Arduino pin 5 on the ATmega328),
+ * so the timer counts the pulses in hardware and there is no interrupt per pulse.
+ * tick() reads the counter and takes the difference to the previous reading.
+ *
+ * The 16 bit counter is extended to 32 bits by the overflow interrupt, i.e. one interrupt every 65536 pulses.
+ *
+ * Timer1 is not available for anything else (Servo, tone() on some cores, PWM on pins 9 and 10).
+ * Timer0 (T0, pin 4) cannot be used, it drives millis().
+ */
+
+#ifndef FLOWMETERCOUNTER_H
+#define FLOWMETERCOUNTER_H
+
+#include "FlowMeter.h"
+
+#define FLOWMETER_COUNTER_PIN 5                   //!< T1, external clock input of Timer/Counter1
+
+/**
+ * FlowMeterCounter
+ *
+ * Usage (instead of attachInterrupt() and count()):
+ *
+ *     FlowMeterCounter Meter = FlowMeterCounter(MySensor);
+ *     Meter.begin();                             // in setup()
+ *     Meter.tick(period);                        // as with FlowMeter
+ */
+class FlowMeterCounter : public FlowMeter {
+  public:
+    FlowMeterCounter(FlowSensorProperties prop = UncalibratedSensor   //!< The properties of the actual flow sensor being used (default: UncalibratedSensor).
+                    );                            //!< Initializes a new flow meter object on pin T1.
+
+    void begin();                                 //!< Takes over Timer1 and starts counting (falling edges, like the interrupt backend).
+    void end();                                   //!< Stops the counter and releases Timer1.
+
+    unsigned long getCounter();                   //!< Returns the 32 bit pulse counter (free running, wraps).
+    FlowPulseSnapshot getSnapshot();              //!< Returns the pulse counter, without timestamp.
+};
+
+#endif   // FLOWMETERCOUNTER_H
@@ -0,0 +1,127 @@
+/*
+ * Flow Meter, pin change interrupt backend
+ */
+
+#include "Arduino.h"
+#include "FlowMeterPinChange.h"
+#include <avr/interrupt.h>
+
+#define FLOWMETER_PINCHANGE_PORTS 3               //!< PCINT0..2: ports B, C and D
+
+static volatile unsigned long pinChangePulses[FLOWMETER_PINCHANGE_METERS];   //!< pulses per meter (free running, wrap)
+static volatile uint8_t pinChangeSequence = 0;    //!< incremented after every update of pinChangePulses
+static volatile uint8_t pinChangeState[FLOWMETER_PINCHANGE_PORTS];           //!< port pins at the previous interrupt
+static volatile uint8_t pinChangeMask[FLOWMETER_PINCHANGE_PORTS];            //!< port pins with a meter
+static volatile uint8_t pinChangeSlot[FLOWMETER_PINCHANGE_PORTS][8];         //!< meter of each port pin
+static uint8_t pinChangeUsed = 0;                 //!< meters in use, one bit each
+
+/**
+ * Counts the falling edges of a port. pins is read first thing in the interrupt; the pins that did not
+ * change, and the rising edges, only update the state.
+ */
+static inline void pinChange(uint8_t port, uint8_t pins) {
+    uint8_t falling = pinChangeState[port] & ~pins & pinChangeMask[port];  //!< was high, is low
+    pinChangeState[port] = pins;
+
+    if (falling) {
+        volatile uint8_t *slot = pinChangeSlot[port];
+        do {
+            if (falling & 1) {
+                pinChangePulses[*slot]++;
+            }
+            slot++;
+        } while (falling >>= 1);                  //!< up to the highest toggled meter only
+        pinChangeSequence++;                      //!< publish, see getSnapshot()
+    }
+}
+
+ISR(PCINT0_vect) {
+    pinChange(0, PINB);
+}
+
+ISR(PCINT1_vect) {
+    pinChange(1, PINC);
+}
+
+ISR(PCINT2_vect) {
+    pinChange(2, PIND);
+}
+
+FlowMeterPinChange::FlowMeterPinChange(unsigned int pin, FlowSensorProperties prop) :
+    FlowMeter(pin, prop)                          //!< input with pullup
+{
+}
+
+bool FlowMeterPinChange::begin() {
+    volatile uint8_t *pcmsk = digitalPinToPCMSK(this->_pin);
+
+    if (this->_slot != 0xFF) {
+        return true;                              //!< already counting
+    }
+    if (pcmsk == 0) {
+        return false;                             //!< no pin change interrupt on this pin
+    }
+
+    uint8_t port = digitalPinToPCICRbit(this->_pin);
+    uint8_t bit = _BV(digitalPinToPCMSKbit(this->_pin));
+    uint8_t slot = 0;
+    while (slot < FLOWMETER_PINCHANGE_METERS && (pinChangeUsed & _BV(slot))) {
+        slot++;
+    }
+    if (slot >= FLOWMETER_PINCHANGE_METERS) {
+        return false;                             //!< all meters in use
+    }
+    pinMode(this->_pin, INPUT_PULLUP);            //!< again, in case the pin was set up after the constructor
+
+    uint8_t sreg = SREG;
+    cli();                                        //!< going to change interrupt registers and variables
+    pinChangeUsed |= _BV(slot);
+    pinChangeSlot[port][digitalPinToPCMSKbit(this->_pin)] = slot;
+    pinChangePulses[slot] = 0;
+    this->_takenPulses = 0;
+    this->_stoppedPulses = 0;
+    this->_slot = slot;
+    uint8_t pins = *portInputRegister(digitalPinToPort(this->_pin));
+    pinChangeState[port] = (pinChangeState[port] & ~bit) | (pins & bit);   //!< this pin only: edges of the others may be pending
+    pinChangeMask[port] |= bit;
+    *pcmsk |= bit;
+    PCICR |= _BV(port);
+    SREG = sreg;                                  //!< done, interrupts as the caller had them
+    return true;
+}
+
+void FlowMeterPinChange::end() {
+    if (this->_slot == 0xFF) {
+        return;
+    }
+
+    volatile uint8_t *pcmsk = digitalPinToPCMSK(this->_pin);
+    uint8_t port = digitalPinToPCICRbit(this->_pin);
+    uint8_t bit = _BV(digitalPinToPCMSKbit(this->_pin));
+
+    uint8_t sreg = SREG;
+    cli();
+    *pcmsk &= ~bit;
+    if (*pcmsk == 0) {
+        PCICR &= ~_BV(port);                      //!< the last meter of this port
+    }
+    pinChangeMask[port] &= ~bit;
+    pinChangeUsed &= ~_BV(this->_slot);
+    this->_stoppedPulses = pinChangePulses[this->_slot];                    //!< the last window keeps its pulses
+    this->_slot = 0xFF;
+    SREG = sreg;
+}
+
+FlowPulseSnapshot FlowMeterPinChange::getSnapshot() {
+    FlowPulseSnapshot snapshot = {this->_stoppedPulses, 0};                 //!< not counting: the count at end()
+    uint8_t sequence;
+
+    if (this->_slot == 0xFF) {
+        return snapshot;
+    }
+    do {
+        sequence = pinChangeSequence;
+        snapshot.pulses = pinChangePulses[this->_slot];                     //!< may be torn by the interrupt ...
+    } while (sequence != pinChangeSequence);                                //!< ... then the sequence has changed
+    return snapshot;                                                        //!< the pulses are not timestamped
+}
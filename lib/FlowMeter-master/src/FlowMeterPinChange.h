@@ -0,0 +1,52 @@
+/**
+ * Flow Meter, pin change interrupt backend
+ *
+ * The ATmega328 has two external interrupts only (INT0 and INT1, pins 2 and 3), but every pin can raise a pin
+ * change interrupt. There is one such interrupt per port (B: pins 8-13, C: A0-A5, D: pins 0-7), shared by its
+ * pins, and it fires on both edges. So the interrupt compares the port with its state at the previous
+ * interrupt: the pins that were high and are low now had a falling edge, and the pulse counter of each is
+ * incremented. Up to FLOWMETER_PINCHANGE_METERS meters, in any mix of ports, are counted by the three
+ * interrupts, several meters toggling at once in a single run.
+ *
+ * Each meter is a FlowMeter with the counter in the interrupt instead of count(); the pulses are not
+ * timestamped. Pulses shorter than the interrupt latency (a few µs) may be missed.
+ *
+ * The library then owns the PCINT0..2 interrupt vectors (as does e.g. SoftwareSerial).
+ * See the PinChangeBudget example for the cycles spent in the interrupt.
+ */
+
+#ifndef FLOWMETERPINCHANGE_H
+#define FLOWMETERPINCHANGE_H
+
+#include "FlowMeter.h"
+
+#define FLOWMETER_PINCHANGE_METERS 8              //!< meters counted at once, any pins
+
+/**
+ * FlowMeterPinChange
+ *
+ * Usage (instead of attachInterrupt() and count()):
+ *
+ *     FlowMeterPinChange Primary = FlowMeterPinChange(4, MySensor);
+ *     FlowMeterPinChange Coil = FlowMeterPinChange(A2, OtherSensor);
+ *     Primary.begin();                           // in setup()
+ *     Coil.begin();
+ *     Primary.tick(period);                      // as with FlowMeter
+ */
+class FlowMeterPinChange : public FlowMeter {
+  public:
+    FlowMeterPinChange(unsigned int pin,          //!< The pin that the flow sensor is connected to (any pin with a pin change interrupt).
+                       FlowSensorProperties prop = UncalibratedSensor   //!< The properties of the actual flow sensor being used (default: UncalibratedSensor).
+                      );                          //!< Initializes a new flow meter object.
+
+    bool begin();                                 //!< Starts counting (falling edges, like the interrupt backend). Returns false without a free meter or pin change interrupt.
+    void end();                                   //!< Stops counting and frees the meter.
+
+    FlowPulseSnapshot getSnapshot();              //!< Returns the pulse counter, without timestamp.
+
+  protected:
+    unsigned char _slot = 0xFF;                   //!< counter used in the interrupt, 0xFF: not counting
+    unsigned long _stoppedPulses = 0;             //!< pulse counter at end()
+};
+
+#endif   // FLOWMETERPINCHANGE_H
@@ -0,0 +1,15 @@
+/*
+ * Flow Meter, Timer1 overflow shared by the hardware counter and input capture backends
+ */
+
+#include "Arduino.h"
+#include "FlowMeterTimer1.h"
+#include <avr/interrupt.h>
+
+volatile uint16_t flowTimer1Overflows = 0;
+volatile uint8_t flowTimer1Sequence = 0;
+
+ISR(TIMER1_OVF_vect) {
+    flowTimer1Overflows++;                        //!< every 65536 pulses (counter) or 262 ms (capture)
+    flowTimer1Sequence++;                         //!< publish
+}
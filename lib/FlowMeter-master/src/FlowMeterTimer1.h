@@ -0,0 +1,33 @@
+/**
+ * Flow Meter, Timer1 overflow shared by the hardware counter and input capture backends
+ *
+ * There is a single TIMER1_OVF_vect, so the interrupt lives in its own translation unit and extends
+ * Timer1 to 32 bits for whichever backend owns the timer (only one of them can).
+ */
+
+#ifndef FLOWMETERTIMER1_H
+#define FLOWMETERTIMER1_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+extern volatile uint16_t flowTimer1Overflows;     //!< upper 16 bits of Timer1, incremented by the overflow interrupt
+extern volatile uint8_t flowTimer1Sequence;       //!< incremented after every update by a Timer1 interrupt, see the readers
+
+/**
+ * TCNT1, read with interrupts disabled for the two byte reads.
+ *
+ * The high byte goes through the TEMP register that all 16 bit registers of Timer1 share. An interrupt
+ * that reads Timer1 in between (FlowMeter::checkFlow() from a timer interrupt) replaces TEMP and the main
+ * loop would get its high byte. The sequence lock does not see this, nothing is published.
+ */
+static inline uint16_t flowTimer1Count() {
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t count = TCNT1;
+    SREG = sreg;
+    return count;
+}
+
+#endif   // FLOWMETERTIMER1_H
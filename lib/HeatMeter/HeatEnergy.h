@@ -0,0 +1,142 @@
+/*********************************************************************
+Heat energy: trapezoidal integration of the thermal power over time.
+
+  HeatEnergy energy;
+  energy.add(heatPowerW(tempIn, tempOut, flow), millis());
+  uint64_t wh = energy.sessionWh();
+
+Each sample adds the area between it and the previous one,
+
+  E += (P[-1] + P) / 2 * (t - t[-1])
+
+with the exact time between the samples (millis(), wraps safely), so an
+irregular sample period does not bias the total. The area is counted in
+half milli-joules (W * ms, the 1/2 of the trapezoid is left in the unit)
+in a 32 bit remainder below 1 Wh, and whole watt-hours are moved to the
+64 bit totals. O(1) per sample, no floating point; the 64 bit product
+is only needed when (P[-1] + P) or the interval exceed 16 bits.
+
+takeMeanPowerW() gives the mean power since its previous call from the
+same areas, so consumers with their own period (a graph column) see every
+sample weighted by its duration, however long the measurement windows are.
+
+The session total starts at 0; the lifetime total is the session plus a
+base the caller restores from non-volatile memory (setLifetimeWh).
+*********************************************************************/
+#ifndef HEATENERGY_H
+#define HEATENERGY_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+// area units (W * ms, twice the trapezoid) per watt-hour: 2 * 3600 * 1000
+#define HEAT_ENERGY_UNITS_WH    7200000UL
+
+// larger powers are clamped so that P[-1] + P fits in 32 bits
+#define HEAT_ENERGY_MAX_WATTS   0x7FFFFFFFUL
+
+
+class HeatEnergy {
+  public:
+    HeatEnergy() {
+      reset();
+    }
+
+    // new session: totals restart at 0, the lifetime base is kept
+    void reset() {
+      _sessionWh = 0;
+      _fraction = 0;
+      _windowArea = 0;
+      _windowTime = 0;
+      _lastPower = 0;
+      _started = false;
+    }
+
+    // power sample (W) taken at time now (ms)
+    void add(uint32_t watts, unsigned long now) {
+      if (watts > HEAT_ENERGY_MAX_WATTS) {
+        watts = HEAT_ENERGY_MAX_WATTS;
+      }
+      if (_started) {
+        unsigned long elapsed = now - _lastTime;
+        uint32_t sum = _lastPower + watts;
+
+        _windowTime += elapsed;
+        if ((sum | elapsed) <= 0xFFFF) {
+          accumulate(sum * elapsed);                  // 16 x 16 bits: the usual case
+          _windowArea += sum * elapsed;
+        }
+        else {
+          uint64_t area = (uint64_t)sum * elapsed;
+          _windowArea += area;
+          uint64_t wh = area / HEAT_ENERGY_UNITS_WH;
+          _sessionWh += wh;
+          accumulate((uint32_t)(area - wh * HEAT_ENERGY_UNITS_WH));
+        }
+      }
+      _lastPower = watts;
+      _lastTime = now;
+      _started = true;
+    }
+
+    // mean power (W) over the time integrated since the previous call (the last sample if none)
+    uint32_t takeMeanPowerW() {
+      uint32_t mean = _windowTime ? _windowArea / (2ULL * _windowTime) : _lastPower;
+
+      _windowArea = 0;
+      _windowTime = 0;
+      return mean;
+    }
+
+    // forgets the last sample: the next one starts a new trapezoid (e.g. after a pause)
+    void restart() {
+      _started = false;
+    }
+
+    uint64_t sessionWh() {
+      return _sessionWh;
+    }
+
+    uint64_t lifetimeWh() {
+      return _lifetimeBaseWh + _sessionWh;
+    }
+
+    // energy below the last whole Wh of the session, in mWh
+    uint16_t sessionFractionMWh() {
+      return _fraction / (HEAT_ENERGY_UNITS_WH / 1000);
+    }
+
+    // lifetime total before this session (restored from EEPROM or similar)
+    void setLifetimeWh(uint64_t wh) {
+      _lifetimeBaseWh = wh;
+    }
+
+  private:
+    uint64_t _sessionWh;
+    uint64_t _lifetimeBaseWh = 0;
+    uint32_t _fraction;                               // below 1 Wh, in HEAT_ENERGY_UNITS_WH
+    uint32_t _lastPower;
+    unsigned long _lastTime;
+    uint64_t _windowArea;                             // since takeMeanPowerW(), in HEAT_ENERGY_UNITS_WH
+    unsigned long _windowTime;                        // ms integrated since takeMeanPowerW()
+    bool _started;
+
+    // area < 2^32 (W * ms)
+    void accumulate(uint32_t area) {
+      if (area >= HEAT_ENERGY_UNITS_WH) {
+        uint32_t wh = area / HEAT_ENERGY_UNITS_WH;
+        _sessionWh += wh;
+        area -= wh * HEAT_ENERGY_UNITS_WH;
+      }
+      _fraction += area;                              // < 2 Wh, no overflow
+      if (_fraction >= HEAT_ENERGY_UNITS_WH) {
+        _fraction -= HEAT_ENERGY_UNITS_WH;
+        _sessionWh++;
+      }
+    }
+};
+
+#endif  // HEATENERGY_H
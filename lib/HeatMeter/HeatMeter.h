@@ -0,0 +1,62 @@
+/*********************************************************************
+Thermal power of a water circuit in integer fixed point.
+
+One unit system from the sensors to the display, all 32 bit integers:
+
+  temperature   deci-degrees (differences are deci-kelvin)
+  flow          millilitres per second (FlowMeter::getCurrentFlowMlps)
+  power         watts
+
+  P = c * Q * dT = 4186 J/(kg K) * Q/1000 kg/s * dK/10 K = 0.4186 * Q * dK
+
+The factor 0.4186 is applied as HEAT_POWER_FACTOR / 65536 (error 1.4e-5)
+and the product is split in its high and low 16 bits, so the whole range
+(65535 ml/s, 6553.5 K) fits in 32 bits with no division and no floating
+point:
+
+  uint32_t watts = heatPowerW(tempIn, tempOut, Meter.getCurrentFlowMlps());
+
+No heat flows back into the stove: tempOut <= tempIn gives 0 W.
+*********************************************************************/
+#ifndef HEATMETER_H
+#define HEATMETER_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#define WATER_HEAT_CAPACITY   4186                          // J/(kg K)
+
+// 0.4186 W per (ml/s * deci-kelvin) in Q16: round(0.4186 * 65536)
+#define HEAT_POWER_FACTOR     27433UL
+
+
+// heat power (W) carried by flowMlps from tempIn to tempOut (deci-degrees)
+inline uint32_t heatPowerW(int16_t tempIn, int16_t tempOut, uint16_t flowMlps) {
+  if (tempOut <= tempIn) {
+    return 0;
+  }
+  // dK < 65536 and Q < 65536: the product fits in 32 bits
+  uint32_t product = (uint32_t)(uint16_t)((uint16_t)tempOut - (uint16_t)tempIn) * flowMlps;
+
+  // (product * factor) >> 16 without the 48 bit intermediate
+  return (product >> 16) * HEAT_POWER_FACTOR +
+         (((product & 0xFFFF) * HEAT_POWER_FACTOR + 0x8000) >> 16);
+}
+
+// the same in double precision, for reference and tests
+inline double heatPowerReference(int16_t tempIn, int16_t tempOut, uint16_t flowMlps) {
+  if (tempOut <= tempIn) {
+    return 0;
+  }
+  return WATER_HEAT_CAPACITY * (flowMlps / 1000.0) * (((double)tempOut - tempIn) / 10.0);
+}
+
+// saturates a 32 bit value to 16 bits (graph buffers)
+inline uint16_t heatSaturate16(uint32_t value) {
+  return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+#endif  // HEATMETER_H
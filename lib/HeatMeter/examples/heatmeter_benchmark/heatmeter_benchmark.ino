@@ -0,0 +1,91 @@
+/*********************************************************************
+Speed and accuracy of the fixed point heat power.
+
+Prints the CPU cycles per call of heatPowerW and of the double precision
+formula, then checks heatPowerW against the double reference over the
+whole working range (flow 0..1000 ml/s, temperature difference 0..100 K)
+plus the extremes of the 16 bit inputs, and prints the worst error.
+*********************************************************************/
+
+#include <HeatMeter.h>
+
+#define RUNS 1000
+
+volatile uint32_t sink;
+volatile double fsink;
+
+// average CPU cycles per call
+unsigned long cyclesFixed() {
+  unsigned long start = micros();
+
+  for (uint16_t i=0; i<RUNS; i++) {
+    sink = heatPowerW(200, 200 + (i & 511), i);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+unsigned long cyclesFloat() {
+  unsigned long start = micros();
+
+  for (uint16_t i=0; i<RUNS; i++) {
+    fsink = heatPowerReference(200, 200 + (i & 511), i);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+double worst = 0;
+uint16_t worstFlow = 0;
+int16_t worstDelta = 0;
+uint32_t checked = 0;
+
+// absolute error beyond 1 W (rounding) relative to the power
+void check(int16_t tempIn, int16_t tempOut, uint16_t flow) {
+  double reference = heatPowerReference(tempIn, tempOut, flow);
+  double error = fabs(heatPowerW(tempIn, tempOut, flow) - reference);
+
+  if (reference > 0 && error > 0.5) {
+    error = (error - 0.5) / reference;
+    if (error > worst) {
+      worst = error;
+      worstFlow = flow;
+      worstDelta = tempOut - tempIn;
+    }
+  }
+  checked++;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  Serial.print(F("fixed: "));
+  Serial.print(cyclesFixed());
+  Serial.print(F(" cycles, double: "));
+  Serial.print(cyclesFloat());
+  Serial.println(F(" cycles"));
+
+  for (uint16_t flow=0; flow<=1000; flow+=7) {
+    for (int16_t delta=-20; delta<=1000; delta+=3) {
+      check(150, 150 + delta, flow);
+    }
+  }
+  check(-32768, 32767, 65535);
+  check(0, 32767, 65535);
+  check(0, 1, 65535);
+  check(0, 32767, 1);
+
+  // negative differences and no flow must give exactly 0
+  bool zero = heatPowerW(600, 400, 1000) == 0 && heatPowerW(400, 600, 0) == 0;
+
+  Serial.print(checked);
+  Serial.print(F(" points, worst relative error "));
+  Serial.print(worst * 1e6, 1);
+  Serial.print(F(" ppm at "));
+  Serial.print(worstFlow);
+  Serial.print(F(" ml/s, "));
+  Serial.print(worstDelta);
+  Serial.println(F(" dK"));
+  Serial.println(zero && worst < 2e-5 ? F("PASS") : F("FAIL"));
+}
+
+void loop() {
+}
@@ -0,0 +1,233 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+/// MedianFilter<N> - running median of the last N samples (N odd, 3..31)
+///
+///   MedianFilter<9> filter;                       // rejects spikes up to 4 samples long
+///   int y = filter.run(x);
+///
+/// Two implementations, MedianFilter<N> picks the faster one:
+///  - SignalFilterSortedMedian<N>: a ring buffer in arrival order plus the
+///    same samples kept sorted. Each sample finds the oldest value with a
+///    binary search and slides the new one into its place, so only the
+///    entries between the old and the new value move (O(N) worst case,
+///    usually a few).
+///  - SignalFilterNetworkMedian<N> (N = 3, 5, 7): copies the window and runs
+///    a fixed median selection network (3, 7 and 13 compare-exchanges), no
+///    branches on the data besides the min/max.
+///
+/// The first sample fills the whole window, so there is no start-up ramp.
+
+#ifndef MedianFilter_h
+#define MedianFilter_h
+#include <Arduino.h>
+
+/// signalFilterSort2: compare-exchange, a <= b afterwards
+inline void signalFilterSort2(int &a, int &b)
+{
+  if (a > b) {
+    int tmp = a;
+    a = b;
+    b = tmp;
+  }
+}
+
+/// SignalFilterMedianNetwork<N>::median(p): median of p[0..N-1], p is scrambled
+template <uint8_t N>
+struct SignalFilterMedianNetwork;
+
+template <>
+struct SignalFilterMedianNetwork<3>
+{
+  static int median(int *p)
+  {
+    signalFilterSort2(p[0], p[1]);
+    signalFilterSort2(p[1], p[2]);
+    signalFilterSort2(p[0], p[1]);
+    return p[1];
+  }
+};
+
+template <>
+struct SignalFilterMedianNetwork<5>
+{
+  static int median(int *p)
+  {
+    signalFilterSort2(p[0], p[1]);
+    signalFilterSort2(p[3], p[4]);
+    signalFilterSort2(p[0], p[3]);
+    signalFilterSort2(p[1], p[4]);
+    signalFilterSort2(p[1], p[2]);
+    signalFilterSort2(p[2], p[3]);
+    signalFilterSort2(p[1], p[2]);
+    return p[2];
+  }
+};
+
+template <>
+struct SignalFilterMedianNetwork<7>
+{
+  static int median(int *p)
+  {
+    signalFilterSort2(p[0], p[5]);
+    signalFilterSort2(p[0], p[3]);
+    signalFilterSort2(p[1], p[6]);
+    signalFilterSort2(p[2], p[4]);
+    signalFilterSort2(p[0], p[1]);
+    signalFilterSort2(p[3], p[5]);
+    signalFilterSort2(p[2], p[6]);
+    signalFilterSort2(p[2], p[3]);
+    signalFilterSort2(p[3], p[6]);
+    signalFilterSort2(p[4], p[5]);
+    signalFilterSort2(p[1], p[4]);
+    signalFilterSort2(p[1], p[3]);
+    signalFilterSort2(p[3], p[4]);
+    return p[3];
+  }
+};
+
+
+/// signalFilterMedianReplace<N, STRIDE>(sorted, old, data): replaces old by data
+/// in the sorted window sorted[0], sorted[STRIDE], ... and returns the median.
+/// Binary search for old, then slide data to its place.
+template <uint8_t N, uint8_t STRIDE>
+int signalFilterMedianReplace(int *sorted, int old, int data)
+{
+  // position of the oldest sample (any of its copies)
+  uint8_t lo=0, hi=N-1;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi) >> 1;
+    if (sorted[mid * STRIDE] < old) {
+      lo = mid + 1;
+    }
+    else {
+      hi = mid;
+    }
+  }
+
+  // slide the new sample from there to its sorted place
+  int *p = sorted + lo * STRIDE;
+  if (data > old) {
+    const int *last = sorted + (N-1) * STRIDE;
+    while (p < last && p[STRIDE] < data) {
+      p[0] = p[STRIDE];
+      p += STRIDE;
+    }
+  }
+  else {
+    while (p > sorted && p[-(int)STRIDE] > data) {
+      p[0] = p[-(int)STRIDE];
+      p -= STRIDE;
+    }
+  }
+  p[0] = data;
+
+  return sorted[(N/2) * STRIDE];
+}
+
+
+/// SignalFilterSortedMedian<N>: insertion-sorted window, any odd N up to 31
+template <uint8_t N>
+class SignalFilterSortedMedian
+{
+  static_assert(N >= 3 && N <= 31 && (N & 1), "MedianFilter: N must be odd, 3..31");
+
+  public:
+    SignalFilterSortedMedian()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      _pos=0;
+      _primed=false;
+    }
+
+    int run(int data)
+    {
+      if (!_primed) {
+        for (uint8_t i=0; i<N; i++) {
+          _ring[i]=data;
+          _sorted[i]=data;
+        }
+        _primed=true;
+        return data;
+      }
+
+      int old = _ring[_pos];
+      _ring[_pos] = data;
+      if (++_pos == N) {
+        _pos=0;
+      }
+
+      return signalFilterMedianReplace<N, 1>(_sorted, old, data);
+    }
+
+  private:
+    int _ring[N];                                 // arrival order
+    int _sorted[N];
+    uint8_t _pos;                                 // oldest sample in _ring
+    bool _primed;
+};
+
+
+/// SignalFilterNetworkMedian<N>: ring buffer + selection network, N = 3, 5, 7
+template <uint8_t N>
+class SignalFilterNetworkMedian
+{
+  public:
+    SignalFilterNetworkMedian()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      _pos=0;
+      _primed=false;
+    }
+
+    int run(int data)
+    {
+      if (!_primed) {
+        for (uint8_t i=0; i<N; i++) {
+          _ring[i]=data;
+        }
+        _primed=true;
+        return data;
+      }
+
+      _ring[_pos] = data;
+      if (++_pos == N) {
+        _pos=0;
+      }
+
+      int p[N];
+      for (uint8_t i=0; i<N; i++) {
+        p[i] = _ring[i];
+      }
+      return SignalFilterMedianNetwork<N>::median(p);
+    }
+
+  private:
+    int _ring[N];
+    uint8_t _pos;
+    bool _primed;
+};
+
+
+/// MedianFilter<N>: the selection network up to 7 samples, the sorted window above
+template <uint8_t N>
+class MedianFilter : public SignalFilterSortedMedian<N> {};
+
+template <>
+class MedianFilter<3> : public SignalFilterNetworkMedian<3> {};
+
+template <>
+class MedianFilter<5> : public SignalFilterNetworkMedian<5> {};
+
+template <>
+class MedianFilter<7> : public SignalFilterNetworkMedian<7> {};
+
+#endif
@@ -4,6 +4,10 @@
 #ifndef SignalFilter_h
 #define SignalFilter_h
 #include <Arduino.h>
+#include <StaticSignalFilter.h>
+#include <MedianFilter.h>
+#include <SignalFilterBank.h>
+#include <SlopeEstimator.h>
 
 class SignalFilter
 {
@@ -18,18 +22,14 @@ class SignalFilter
     int run(int data);
 
   private:
+    typedef int (*Kernel)(int *v, int data);
+
+    void selectKernel();
+    static int runNone(int *v, int data);
 
-    int runChebyshev(int data);
-    int runBessel(int data);
-    int runMedian(int data);
-    int runGrowing(int data);
-    int runGrowing2(int data);
     char _filter;
     int _order;
-    int _average;
-    int _median;
-    int _helper;
-    int _counter;
+    Kernel _kernel;                               // chosen by setFilter/setOrder, not per sample
 
     int _v[3];
 };
@@ -0,0 +1,109 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+/// SignalFilterBank - the same filter on several channels, one call per sample set
+///
+///   SignalFilterBank<4, 'b', 2> bank;             // 4 channels, 2nd order Bessel
+///   int values[4];                                // fill with raw samples
+///   bank.run(values, values);                     // filtered in place
+///
+///   MedianFilterBank<4, 9> medians;               // 9 sample running median
+///
+/// The state is laid out as struct-of-arrays: one row per state variable,
+/// one column per channel (_v[row * CHANNELS + channel]). The filter is a
+/// template parameter, so there is no dispatch at all, and run() is one
+/// tight loop over the channels with constant offsets between the rows.
+/// MedianFilterBank also shares the ring position and start-up flag of all
+/// channels, which advance together.
+///
+/// SignalFilterBank gives the same output per channel as StaticSignalFilter
+/// (same kernels), MedianFilterBank as SignalFilterSortedMedian.
+
+#ifndef SignalFilterBank_h
+#define SignalFilterBank_h
+#include <Arduino.h>
+#include <StaticSignalFilter.h>
+#include <MedianFilter.h>
+
+template <uint8_t CHANNELS, char KIND = 'm', uint8_t ORDER = 1>
+class SignalFilterBank
+{
+  public:
+    SignalFilterBank()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      for (uint16_t i=0; i<3 * CHANNELS; i++) {           // may exceed 255
+        _v[i]=0;
+      }
+    }
+
+    /// run: filters in[0..CHANNELS-1] into out (may be the same array)
+    void run(const int *in, int *out)
+    {
+      for (uint8_t c=0; c<CHANNELS; c++) {
+        out[c] = SignalFilterKernel<KIND, ORDER>::template run<CHANNELS>(_v + c, in[c]);
+      }
+    }
+
+  private:
+    int _v[3 * CHANNELS];
+};
+
+
+template <uint8_t CHANNELS, uint8_t N>
+class MedianFilterBank
+{
+  static_assert(N >= 3 && N <= 31 && (N & 1), "MedianFilterBank: N must be odd, 3..31");
+
+  public:
+    MedianFilterBank()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      _pos=0;
+      _primed=false;
+    }
+
+    /// run: filters in[0..CHANNELS-1] into out (may be the same array)
+    void run(const int *in, int *out)
+    {
+      if (!_primed) {
+        for (uint16_t i=0; i<N * CHANNELS; i++) {       // may exceed 255
+          _ring[i]=in[i % CHANNELS];
+          _sorted[i]=in[i % CHANNELS];
+        }
+        for (uint8_t c=0; c<CHANNELS; c++) {
+          out[c]=in[c];
+        }
+        _primed=true;
+        return;
+      }
+
+      int *ring = _ring + _pos * CHANNELS;
+      for (uint8_t c=0; c<CHANNELS; c++) {
+        int data = in[c];
+        int old = ring[c];
+
+        ring[c] = data;
+        out[c] = signalFilterMedianReplace<N, CHANNELS>(_sorted + c, old, data);
+      }
+      if (++_pos == N) {
+        _pos=0;
+      }
+    }
+
+  private:
+    int _ring[N * CHANNELS];                      // arrival order, one row per sample
+    int _sorted[N * CHANNELS];                    // sorted columns
+    uint8_t _pos;                                 // oldest row in _ring
+    bool _primed;
+};
+
+#endif
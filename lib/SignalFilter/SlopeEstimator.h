@@ -0,0 +1,131 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+/// SlopeEstimator<N> - least squares line over the last N evenly spaced samples
+///
+///   SlopeEstimator<30> trend;                     // one sample every 2 s: 1 minute
+///   trend.add(temperature);
+///   if (trend.samplesTo(800) < 60) ...            // 800 reached within 2 minutes
+///
+/// The fit is updated in O(1) per sample from two running sums, S0 = sum(y)
+/// and S1 = sum(i * y) with i = 0 for the oldest sample:
+///
+///   slope = (12 * S1 - 6 * (n-1) * S0) / (n * (n^2 - 1))   per sample
+///
+/// so there is no loop over the window and no floating point. The least
+/// squares slope averages the noise of the whole window, unlike the
+/// difference of two samples. All products fit in 32 bits for |y| <= 4000
+/// and N <= 32.
+
+#ifndef SlopeEstimator_h
+#define SlopeEstimator_h
+#include <Arduino.h>
+
+#define SLOPE_NEVER  0xFFFF                       // samplesTo(): not rising, or not enough data
+
+template <uint8_t N>
+class SlopeEstimator
+{
+  static_assert(N >= 3 && N <= 32, "SlopeEstimator: N must be 3..32");
+
+  public:
+    SlopeEstimator()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      _count=0;
+      _pos=0;
+      _s0=0;
+      _s1=0;
+    }
+
+    void add(int y)
+    {
+      if (_count < N) {
+        _s1 += (long)_count * y;
+        _s0 += y;
+        _ring[_count++] = y;
+        return;
+      }
+      // every sample moves one place back, the oldest (index 0) leaves
+      int old = _ring[_pos];
+      _s1 += (long)(N-1) * y - (_s0 - old);
+      _s0 += y - old;
+      _ring[_pos] = y;
+      if (++_pos == N) {
+        _pos=0;
+      }
+    }
+
+    uint8_t count()
+    {
+      return _count;
+    }
+
+    bool full()
+    {
+      return _count == N;
+    }
+
+    /// slope = slopeNumerator() / slopeDenominator() units per sample
+    long slopeNumerator()
+    {
+      return 12 * _s1 - 6L * (_count-1) * _s0;
+    }
+
+    long slopeDenominator()
+    {
+      return (long)_count * ((long)_count * _count - 1);
+    }
+
+    /// slope in 1/256 units per sample (0 with less than 2 samples)
+    long slope256()
+    {
+      if (_count < 2) {
+        return 0;
+      }
+      long num = slopeNumerator();
+      long den = slopeDenominator();
+      return (num / den) * 256 + (num % den) * 256 / den;
+    }
+
+    /// value of the fitted line at the newest sample, less noisy than the sample
+    int level()
+    {
+      if (_count < 2) {
+        return _count ? (int)_s0 : 0;
+      }
+      return (int)(_s0 / _count + slopeNumerator() * (_count-1) / (2 * slopeDenominator()));
+    }
+
+    /// samples until the fitted line reaches threshold: 0 if already there,
+    /// SLOPE_NEVER if it is not rising or the window is not full yet
+    uint16_t samplesTo(int threshold)
+    {
+      if (_count < N) {
+        return SLOPE_NEVER;
+      }
+      long distance = (long)threshold - level();
+      if (distance <= 0) {
+        return 0;
+      }
+      long num = slopeNumerator();
+      if (num <= 0) {
+        return SLOPE_NEVER;
+      }
+      long samples = distance * slopeDenominator() / num;
+      return (samples >= SLOPE_NEVER) ? SLOPE_NEVER - 1 : (uint16_t)samples;
+    }
+
+  private:
+    int _ring[N];
+    uint8_t _count;
+    uint8_t _pos;                                 // oldest sample once full
+    long _s0;                                     // sum(y)
+    long _s1;                                     // sum(i * y), i = 0 oldest
+};
+
+#endif
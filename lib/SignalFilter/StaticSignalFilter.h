@@ -0,0 +1,331 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+/// StaticSignalFilter - compile-time selected filters
+///
+/// The filter kind and order are template parameters, so every instance
+/// compiles to the straight-line code of one filter, with no per-sample
+/// dispatch:
+///
+///   StaticSignalFilter<'b', 2> filter;              // 2nd order Bessel
+///   int y = filter.run(x);
+///
+/// Kinds are the same characters SignalFilter::setFilter() takes:
+/// 'c' Chebyshev and 'b' Bessel (order 1 or 2), 'm' median of 3,
+/// 'g'/'h' growing-shrinking. The runtime SignalFilter class runs the same
+/// kernels (SignalFilterKernel), so both give identical output.
+///
+/// Filters of any order are built from second order sections with Q(FRAC)
+/// fixed point coefficients computed by the compiler:
+///
+///   typedef SignalFilterBiquad<SIGNAL_FILTER_Q(0.019), ...> Section1;
+///   SignalFilterCascade<Section1, Section2> lowpass;   // 4th order
+///
+/// tools/filter_design.py designs these for a sample rate and cutoff and
+/// writes the header, with the quantization and overflow report.
+///
+/// The accumulator is 32 bits, so the input bits + FRAC + 2 must stay
+/// below 31 (Q14 takes 13 bit oversampled ADC values).
+
+#ifndef StaticSignalFilter_h
+#define StaticSignalFilter_h
+#include <Arduino.h>
+
+/// signalFilterQ: double coefficient to Q(frac) fixed point, rounded
+constexpr long signalFilterQ(double coefficient, uint8_t frac)
+{
+  return (long)(coefficient * (1L << frac) + (coefficient >= 0 ? 0.5 : -0.5));
+}
+
+#define SIGNAL_FILTER_FRAC  14
+#define SIGNAL_FILTER_Q(c)  signalFilterQ((c), SIGNAL_FILTER_FRAC)
+
+
+/// SignalFilterKernel<KIND, ORDER>::run<STRIDE>(v, data): one sample of one filter.
+/// The filter state is 3 ints, v[0], v[STRIDE] and v[2*STRIDE], zeroed before
+/// the first sample. STRIDE is 1 for one filter and the channel count for
+/// SignalFilterBank, which keeps the state of all channels row by row.
+template <char KIND, uint8_t ORDER>
+struct SignalFilterKernel
+{
+  static_assert(KIND != KIND, "SignalFilter: unsupported filter kind or order");
+};
+
+template <>
+struct SignalFilterKernel<'c', 1>                 //ripple -3dB
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE];
+
+    v0 = v1;
+    long tmp = ((((data * 3269048L) >>  2)        //= (3.897009118e-1 * data)
+      + ((v0 * 3701023L) >> 3)                    //+(  0.2205981765*v[0])
+      )+1048576) >> 21;                           // round and downshift fixed point /2097152
+    v1= (int)tmp;
+    return (int)(v0 + v1);                        // 2^
+  }
+};
+
+template <>
+struct SignalFilterKernel<'c', 2>                 //ripple -1dB
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE], &v2 = v[2 * STRIDE];
+
+    v0 = v1;
+    v1 = v2;
+    long tmp = ((((data * 662828L) >>  4)         //= (    7.901529699e-2 * x)
+      + ((v0 * -540791L) >> 1)                    //+( -0.5157387562*v[0])
+      + (v1 * 628977L)                            //+(  1.1996775682*v[1])
+      )+262144) >> 19;                            // round and downshift fixed point /524288
+
+    v2= (int)tmp;
+    return (int)((
+      (v0 + v2)
+      +2 * v1));                                  // 2^
+  }
+};
+
+template <>
+struct SignalFilterKernel<'b', 1>                 //Alpha Low 0.1
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE];
+
+    v0 = v1;
+    long tmp = ((((data * 2057199L) >>  3)        //= (    2.452372753e-1 * data)
+      + ((v0 * 1068552L) >> 1)                    //+(  0.5095254495*v[0])
+      )+524288) >> 20;                            // round and downshift fixed point /1048576
+    v1= (int)tmp;
+    return (int)(((v0 + v1)));                    // 2^
+  }
+};
+
+template <>
+struct SignalFilterKernel<'b', 2>                 //Alpha Low 0.1
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE], &v2 = v[2 * STRIDE];
+
+    v0 = v1;
+    v1 = v2;
+    long tmp = ((((data * 759505L) >>  4)         //= (    9.053999670e-2 * data)
+      + ((v0 * -1011418L) >> 3)                   //+( -0.2411407388*v[0])
+      + ((v1 * 921678L) >> 1)                     //+(  0.8789807520*v[1])
+      )+262144) >> 19;                            // round and downshift fixed point /524288
+
+    v2= (int)tmp;
+    return (int)(((v0 + v2)+2 * v1));             // 2^
+  }
+};
+
+/// Median of the last 3 samples, the order is ignored
+template <uint8_t ORDER>
+struct SignalFilterKernel<'m', ORDER>
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE], &v2 = v[2 * STRIDE];
+
+    v0 = v1;
+    v1 = v2;
+    v2= data;
+
+    if (v2 < v1) {
+      if (v2 < v0) {
+        return (v1 < v0) ? v1 : v0;
+      }
+      return v2;
+    }
+    if (v2 < v0) {
+      return v2;
+    }
+    return (v1 < v0) ? v0 : v1;
+  }
+};
+
+/// Growing-shrinking filter (fast), v0 is the output
+template <uint8_t ORDER>
+struct SignalFilterKernel<'g', ORDER>
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0];
+    int helper = v0;
+
+    if (data > helper) {
+      if (data > helper+512)
+        helper=helper+512;
+      if (data > helper+128)
+        helper=helper+128;
+      if (data > helper+32)
+        helper=helper+32;
+      if (data > helper+8)
+        helper=helper+8;
+      helper++;
+    }
+    else if (data < helper) {
+      if (data < helper-512)
+        helper=helper-512;
+      if (data < helper-128)
+        helper=helper-128;
+      if (data < helper-32)
+        helper=helper-32;
+      if (data < helper-8)
+        helper=helper-8;
+      helper--;
+    }
+    v0 = helper;
+    return helper;
+  }
+};
+
+/// Growing-shrinking filter (smoother), v0 is the output, v1 the step counter
+template <uint8_t ORDER>
+struct SignalFilterKernel<'h', ORDER>
+{
+  template <uint8_t STRIDE>
+  static int run(int *v, int data)
+  {
+    int &v0 = v[0], &v1 = v[STRIDE];
+    int helper = v0;
+    int counter = v1;
+
+    if (data > helper) {
+      if (data > helper+8) {
+        counter++;
+        helper=helper + 8 * counter;
+      }
+      helper++;
+    }
+    else if (data < helper) {
+      if (data < helper-8) {
+        counter++;
+        helper=helper- 8 * counter;
+      }
+      helper--;
+    }
+
+    if (counter > 10) {
+      counter=0;
+    }
+    v0 = helper;
+    v1 = counter;
+    return helper;
+  }
+};
+
+
+/// StaticSignalFilter<KIND, ORDER>: one filter chosen at compile time
+template <char KIND, uint8_t ORDER = 1>
+class StaticSignalFilter
+{
+  public:
+    StaticSignalFilter()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      _v[0]=0;
+      _v[1]=0;
+      _v[2]=0;
+    }
+
+    int run(int data)
+    {
+      return SignalFilterKernel<KIND, ORDER>::template run<1>(_v, data);
+    }
+
+  private:
+    int _v[3];
+};
+
+
+/// SignalFilterBiquad: second order section, direct form I
+///   y = b0*x + b1*x[-1] + b2*x[-2] - a1*y[-1] - a2*y[-2]
+/// NUM0..2 = b0..b2 and DEN1..2 = a1..a2 in Q(FRAC), see SIGNAL_FILTER_Q().
+/// (B0, A1... are Arduino macros.) State: x1, x2, y1, y2
+template <long NUM0, long NUM1, long NUM2, long DEN1, long DEN2, uint8_t FRAC = SIGNAL_FILTER_FRAC>
+struct SignalFilterBiquad
+{
+  static const uint8_t STATE = 4;
+
+  static int run(int *s, int x)
+  {
+    long acc = NUM0 * x + NUM1 * s[0] + NUM2 * s[1] - DEN1 * s[2] - DEN2 * s[3];
+    int y = (int)((acc + (1L << (FRAC - 1))) >> FRAC);
+
+    s[1] = s[0];
+    s[0] = x;
+    s[3] = s[2];
+    s[2] = y;
+    return y;
+  }
+};
+
+/// SignalFilterChain: runs the sections one after another (unrolled by the compiler)
+template <class... SECTIONS>
+struct SignalFilterChain;
+
+template <>
+struct SignalFilterChain<>
+{
+  static const uint8_t STATE = 0;
+
+  static int run(int *, int data)
+  {
+    return data;
+  }
+};
+
+template <class SECTION, class... REST>
+struct SignalFilterChain<SECTION, REST...>
+{
+  static const uint8_t STATE = SECTION::STATE + SignalFilterChain<REST...>::STATE;
+
+  static int run(int *s, int data)
+  {
+    return SignalFilterChain<REST...>::run(s + SECTION::STATE, SECTION::run(s, data));
+  }
+};
+
+/// SignalFilterCascade<S1, S2, ...>: IIR filter of any order as a cascade of biquads
+template <class... SECTIONS>
+class SignalFilterCascade
+{
+  public:
+    SignalFilterCascade()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      for (uint8_t i=0; i<Chain::STATE; i++) {
+        _s[i]=0;
+      }
+    }
+
+    int run(int data)
+    {
+      return Chain::run(_s, data);
+    }
+
+  private:
+    typedef SignalFilterChain<SECTIONS...> Chain;
+    int _s[Chain::STATE];
+};
+
+#endif
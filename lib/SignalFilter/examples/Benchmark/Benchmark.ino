@@ -0,0 +1,79 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+// Cycles per sample of every filter: the runtime SignalFilter (kernel chosen
+// by setFilter/setOrder) against the same filter as a StaticSignalFilter,
+// and a 4th order Butterworth (fc = 0.05 fs) biquad cascade.
+
+#include <SignalFilter.h>
+
+#define RUNS 1000
+
+// 4th order Butterworth low pass, fc = 0.05 * sample rate
+typedef SignalFilterBiquad<SIGNAL_FILTER_Q(0.0190368316), SIGNAL_FILTER_Q(0.0380736632),
+                           SIGNAL_FILTER_Q(0.0190368316), SIGNAL_FILTER_Q(-1.4796742168),
+                           SIGNAL_FILTER_Q(0.5558215432)> Butterworth1;
+typedef SignalFilterBiquad<SIGNAL_FILTER_Q(0.0218838520), SIGNAL_FILTER_Q(0.0437677039),
+                           SIGNAL_FILTER_Q(0.0218838520), SIGNAL_FILTER_Q(-1.7009643313),
+                           SIGNAL_FILTER_Q(0.7884997391)> Butterworth2;
+
+int samples[64];
+volatile int sink;
+
+// average CPU cycles per run() call, loop overhead included
+template <class FILTER>
+unsigned long cycles(FILTER &filter)
+{
+  unsigned long start = micros();
+
+  for (int i=0; i<RUNS; i++) {
+    sink = filter.run(samples[i & 63]);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+void report(const char *name, unsigned long runtime, unsigned long compiled)
+{
+  Serial.print(name);
+  Serial.print("\t");
+  Serial.print(runtime);
+  Serial.print("\t");
+  Serial.println(compiled);
+}
+
+template <char KIND, uint8_t ORDER>
+void compare(const char *name)
+{
+  SignalFilter runtime;
+  StaticSignalFilter<KIND, ORDER> compiled;
+
+  runtime.begin();
+  runtime.setFilter(KIND);
+  runtime.setOrder(ORDER);
+  report(name, cycles(runtime), cycles(compiled));
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  for (int i=0; i<64; i++) {
+    samples[i] = 512 + random(-64, 64);
+  }
+
+  Serial.println("filter\t\truntime\tstatic (cycles/sample)");
+  compare<'c', 1>("chebyshev 1");
+  compare<'c', 2>("chebyshev 2");
+  compare<'b', 1>("bessel 1");
+  compare<'b', 2>("bessel 2");
+  compare<'m', 1>("median 3");
+  compare<'g', 1>("growing");
+  compare<'h', 1>("growing 2");
+
+  SignalFilterCascade<Butterworth1, Butterworth2> butterworth;
+  Serial.print("butterworth 4\t-\t");
+  Serial.println(cycles(butterworth));
+}
+
+void loop()
+{
+}
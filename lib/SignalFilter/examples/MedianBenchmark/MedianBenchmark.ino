@@ -0,0 +1,60 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+// Cycles per sample of MedianFilter<N> for every window size we use, and of
+// both implementations at N = 5 and 7 (where MedianFilter picks the network).
+// Noisy input with spikes, like a thermistor on a long cable.
+
+#include <SignalFilter.h>
+
+#define RUNS 1000
+
+int samples[64];
+volatile int sink;
+
+// average CPU cycles per run() call, loop overhead included
+template <class FILTER>
+unsigned long cycles()
+{
+  FILTER filter;
+  unsigned long start = micros();
+
+  for (int i=0; i<RUNS; i++) {
+    sink = filter.run(samples[i & 63]);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+void report(const char *name, unsigned long value)
+{
+  Serial.print(name);
+  Serial.print("\t");
+  Serial.println(value);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  for (int i=0; i<64; i++) {
+    samples[i] = 4096 + random(-16, 16);
+    if (random(8) == 0) {
+      samples[i] += random(-2000, 2000);        // spike
+    }
+  }
+
+  Serial.println("window\t\tcycles/sample");
+  report("3 legacy 'm'", cycles<StaticSignalFilter<'m'> >());
+  report("3 network", cycles<MedianFilter<3> >());
+  report("5 network", cycles<SignalFilterNetworkMedian<5> >());
+  report("5 sorted", cycles<SignalFilterSortedMedian<5> >());
+  report("7 network", cycles<SignalFilterNetworkMedian<7> >());
+  report("7 sorted", cycles<SignalFilterSortedMedian<7> >());
+  report("9 sorted", cycles<MedianFilter<9> >());
+  report("15 sorted", cycles<MedianFilter<15> >());
+  report("21 sorted", cycles<MedianFilter<21> >());
+  report("31 sorted", cycles<MedianFilter<31> >());
+}
+
+void loop()
+{
+}
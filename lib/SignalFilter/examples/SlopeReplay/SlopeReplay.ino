@@ -0,0 +1,81 @@
+// Arduino Signal Filtering Library
+// Copyright 2012-2013 Jeroen Doggen (jeroendoggen@gmail.com)
+
+// Replays pump stall traces through SlopeEstimator and prints when the
+// plain threshold alarm and the predictive (time to threshold) alarm fire.
+// Outlet temperature in deci-degrees, one sample every 2 s, +-0.3 C noise:
+//  - steady 65 C for 4 minutes (must not alarm), then the pump stalls and
+//    the outlet rises 2, 4 or 8 C per minute
+//  - a slow warm up at 0.5 C per minute up to 75 C (must not alarm)
+
+#include <SignalFilter.h>
+
+#define PERIOD        2                           // s between samples
+#define THRESHOLD     800                         // 80 C
+#define LEAD_TIME     120                         // s
+#define STALL_START   240                         // s
+
+unsigned long seed = 1;
+
+int noise()
+{
+  seed = seed * 1103515245UL + 12345;
+  return (int)((seed >> 16) % 7) - 3;
+}
+
+// outlet temperature at t seconds, rise in deci-degrees per minute after the stall
+int trace(unsigned int t, int rise)
+{
+  if (rise == 0) {
+    return min(650 + (int)(t * 5L / 60), 750) + noise();  // warm up, 0.5 C/min
+  }
+  if (t < STALL_START) {
+    return 650 + noise();
+  }
+  return 650 + (int)((t - STALL_START) * (long)rise / 60) + noise();
+}
+
+void replay(int rise)
+{
+  SlopeEstimator<30> trend;
+  long thresholdAt = -1, predictedAt = -1;
+
+  for (unsigned int t=0; t<1800; t+=PERIOD) {
+    int y = trace(t, rise);
+
+    trend.add(y);
+    if (thresholdAt < 0 && y >= THRESHOLD) {
+      thresholdAt = t;
+    }
+    if (predictedAt < 0 && trend.samplesTo(THRESHOLD) <= LEAD_TIME / PERIOD) {
+      predictedAt = t;
+    }
+  }
+
+  Serial.print(rise / 10);
+  Serial.print(" C/min\tthreshold at ");
+  Serial.print(thresholdAt);
+  Serial.print(" s\tpredictive at ");
+  Serial.print(predictedAt);
+  Serial.print(" s");
+  if (thresholdAt >= 0 && predictedAt >= 0) {
+    Serial.print("\t");
+    Serial.print(thresholdAt - predictedAt);
+    Serial.print(" s earlier");
+  }
+  Serial.println();
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("stall at 240 s, -1 = never");
+  replay(20);
+  replay(40);
+  replay(80);
+  replay(0);                                      // warm up, no alarm expected
+}
+
+void loop()
+{
+}
@@ -0,0 +1,338 @@
+#!/usr/bin/env python3
+"""
+Fixed-point low pass filter designer for SignalFilter.
+
+Designs Butterworth, Bessel or Chebyshev (type I) low pass filters for a
+sample rate and cutoff, splits them into second order sections, quantizes
+the coefficients to the Q(FRAC) format of SignalFilterBiquad and writes a
+header with a ready to use SignalFilterCascade:
+
+  $ python3 filter_design.py --type butterworth --order 4 --fs 7.63 --fc 0.5 \\
+        --name TempLowpass --output TempLowpass.h
+
+  #include <SignalFilter.h>
+  #include "TempLowpass.h"
+  TempLowpass filter;                 // int y = filter.run(x);
+
+The report (stderr) lists, per section and for the whole cascade:
+  - quantization error: pole radius (stability margin), DC gain and the
+    worst passband deviation of the quantized response from the ideal one
+  - overflow headroom: worst case |accumulator| for full scale input against
+    the 32 bit accumulator, and the peak gain of every partial cascade
+    (the int between sections must not overflow 16 bits)
+  - latency and noise: group delay at DC and the white noise gain, the
+    numbers to trade filter latency against noise.
+
+Only the standard library is needed (no numpy/scipy).
+"""
+
+import argparse
+import cmath
+import math
+import sys
+
+ACCUMULATOR_BITS = 31          # signed 32 bit long
+INT_BITS = 15                  # signed 16 bit int on AVR
+
+
+# ---------------------------------------------------------------------------
+# analog prototypes, cutoff 1 rad/s, left half plane poles
+
+def butterworth_poles(order):
+    return [cmath.exp(1j * math.pi * (2 * k + order + 1) / (2 * order))
+            for k in range(order)]
+
+
+def chebyshev_poles(order, ripple_db):
+    eps = math.sqrt(10 ** (ripple_db / 10.0) - 1)
+    mu = math.asinh(1 / eps) / order
+    poles = []
+    for k in range(order):
+        theta = math.pi * (2 * k + 1) / (2 * order)
+        poles.append(complex(-math.sinh(mu) * math.sin(theta),
+                             math.cosh(mu) * math.cos(theta)))
+    return poles
+
+
+def polynomial_roots(coefficients):
+    """Durand-Kerner, coefficients highest power first."""
+    n = len(coefficients) - 1
+    monic = [c / coefficients[0] for c in coefficients]
+    roots = [(0.4 + 0.9j) ** k for k in range(n)]
+    for _ in range(500):
+        new = []
+        for i, r in enumerate(roots):
+            value = 0
+            for c in monic:
+                value = value * r + c
+            denominator = 1
+            for j, s in enumerate(roots):
+                if i != j:
+                    denominator *= (r - s)
+            new.append(r - value / denominator)
+        done = max(abs(a - b) for a, b in zip(new, roots)) < 1e-14
+        roots = new
+        if done:
+            break
+    return roots
+
+
+def analog_magnitude(poles, w):
+    gain = 1
+    for p in poles:
+        gain *= abs(p) / abs(1j * w - p)
+    return gain
+
+
+def bessel_poles(order):
+    # reverse Bessel polynomial theta_n(s), a_k = (2n-k)! / (2^(n-k) k! (n-k)!)
+    coefficients = [math.factorial(2 * order - k) /
+                    (2 ** (order - k) * math.factorial(k) * math.factorial(order - k))
+                    for k in range(order, -1, -1)]
+    poles = polynomial_roots(coefficients)
+    # normalize to -3 dB at 1 rad/s
+    lo, hi = 0.01, 100.0
+    for _ in range(200):
+        mid = math.sqrt(lo * hi)
+        if analog_magnitude(poles, mid) > math.sqrt(0.5):
+            lo = mid
+        else:
+            hi = mid
+    return [p / lo for p in poles]
+
+
+# ---------------------------------------------------------------------------
+# digital sections
+
+class Section:
+    """b0 + b1 z^-1 + b2 z^-2 / 1 + a1 z^-1 + a2 z^-2"""
+
+    def __init__(self, b, a):
+        self.b = list(b)
+        self.a = list(a)
+
+    def response(self, w):
+        z1 = cmath.exp(-1j * w)
+        z2 = z1 * z1
+        return ((self.b[0] + self.b[1] * z1 + self.b[2] * z2) /
+                (1 + self.a[0] * z1 + self.a[1] * z2))
+
+    def pole_radius(self):
+        a1, a2 = self.a
+        disc = a1 * a1 - 4 * a2
+        if disc >= 0:
+            r = [abs((-a1 + math.sqrt(disc)) / 2), abs((-a1 - math.sqrt(disc)) / 2)]
+        else:
+            r = [math.sqrt(a2)]
+        return max(r)
+
+    def quantized(self, frac):
+        q = lambda c: int(math.floor(c * (1 << frac) + 0.5))
+        return [q(c) for c in self.b], [q(c) for c in self.a]
+
+
+def digital_sections(poles, fs, fc):
+    """Bilinear transform with prewarping. Zeros all at z = -1, every section
+    normalized to unity DC gain, ordered from the lowest to the highest Q so
+    the intermediate values peak as late as possible."""
+    warped = 2 * fs * math.tan(math.pi * fc / fs)
+    zpoles = []
+    for p in poles:
+        s = p * warped
+        zpoles.append((1 + s / (2 * fs)) / (1 - s / (2 * fs)))
+
+    real = [z.real for z in zpoles if abs(z.imag) < 1e-9]
+    pairs = [z for z in zpoles if z.imag > 1e-9]
+    pairs.sort(key=lambda z: abs(z))
+
+    sections = []
+    for z in real:
+        a = [-z, 0.0]
+        g = (1 + a[0]) / 2
+        sections.append(Section([g, g, 0.0], a))
+    for z in pairs:
+        a = [-2 * z.real, abs(z) ** 2]
+        g = (1 + a[0] + a[1]) / 4
+        sections.append(Section([g, 2 * g, g], a))
+    return sections
+
+
+def quantized_sections(sections, frac):
+    out = []
+    for s in sections:
+        b, a = s.quantized(frac)
+        out.append(Section([x / float(1 << frac) for x in b],
+                           [x / float(1 << frac) for x in a]))
+    return out
+
+
+def cascade_response(sections, w):
+    h = 1
+    for s in sections:
+        h *= s.response(w)
+    return h
+
+
+def impulse_response(sections, length):
+    x = [1.0] + [0.0] * (length - 1)
+    for s in sections:
+        y = []
+        x1 = x2 = y1 = y2 = 0.0
+        for v in x:
+            out = s.b[0] * v + s.b[1] * x1 + s.b[2] * x2 - s.a[0] * y1 - s.a[1] * y2
+            x2, x1 = x1, v
+            y2, y1 = y1, out
+            y.append(out)
+        x = y
+    return x
+
+
+# ---------------------------------------------------------------------------
+# report and header
+
+def design(args):
+    if args.type == 'butterworth':
+        poles = butterworth_poles(args.order)
+    elif args.type == 'bessel':
+        poles = bessel_poles(args.order)
+    else:
+        poles = chebyshev_poles(args.order, args.ripple)
+    return digital_sections(poles, args.fs, args.fc)
+
+
+def report(args, ideal, quant, out):
+    def db(x):
+        return 20 * math.log10(max(abs(x), 1e-12))
+
+    full_scale = (1 << args.input_bits) - 1
+    print('%s low pass, order %d, fs %g Hz, fc %g Hz, Q%d coefficients'
+          % (args.type, args.order, args.fs, args.fc, args.frac), file=out)
+    print('', file=out)
+    print('section  pole radius (ideal/quantized)  DC gain  |acc| max  headroom  peak gain',
+          file=out)
+
+    ok = True
+    for i in range(len(ideal)):
+        b, a = ideal[i].quantized(args.frac)
+        radius = quant[i].pole_radius()
+        dc = abs(quant[i].response(0))
+        # accumulator: |b|*x + |a|*y with x, y at the worst partial cascade peak
+        peak_in = max(abs(cascade_response(quant[:i], w)) for w in frequencies()) if i else 1.0
+        peak_out = max(abs(cascade_response(quant[:i + 1], w)) for w in frequencies())
+        x = full_scale * peak_in
+        y = full_scale * peak_out
+        acc = sum(abs(c) for c in b) * x + sum(abs(c) for c in a) * y
+        headroom = ACCUMULATOR_BITS - math.log2(acc)
+        print('S%-7d %.6f / %.6f            %.5f  %.3g    %5.1f bits  %.3f'
+              % (i + 1, ideal[i].pole_radius(), radius, dc, acc, headroom, peak_out), file=out)
+        if radius >= 1:
+            print('  ERROR: quantized section is unstable, use more FRAC bits', file=out)
+            ok = False
+        if headroom < 0:
+            print('  ERROR: accumulator overflow, use fewer FRAC or input bits', file=out)
+            ok = False
+        if y >= (1 << INT_BITS):
+            print('  ERROR: section output overflows a 16 bit int', file=out)
+            ok = False
+
+    passband = [w for w in frequencies() if w <= 2 * math.pi * args.fc / args.fs]
+    worst = max(abs(db(cascade_response(quant, w)) - db(cascade_response(ideal, w)))
+                for w in passband)
+    h = impulse_response(quant, 4096)
+    noise_gain = sum(v * v for v in h)
+    # group delay at DC = sum(n h[n]) / sum(h[n])
+    delay = sum(n * v for n, v in enumerate(h)) / sum(h)
+
+    print('', file=out)
+    print('DC gain (quantized)         %.5f' % abs(cascade_response(quant, 0)), file=out)
+    print('passband error              %.4f dB max' % worst, file=out)
+    print('-3 dB point (quantized)     %.4g Hz' % cutoff(quant, args.fs), file=out)
+    print('latency (group delay @ DC)  %.2f samples, %.3f s' % (delay, delay / args.fs), file=out)
+    print('white noise gain            %.4f (noise rms x %.3f)' % (noise_gain, math.sqrt(noise_gain)),
+          file=out)
+    return ok
+
+
+def frequencies(points=512):
+    return [math.pi * k / points for k in range(points + 1)]
+
+
+def cutoff(sections, fs):
+    target = math.sqrt(0.5) * abs(cascade_response(sections, 0))
+    lo, hi = 0.0, math.pi
+    for _ in range(60):
+        mid = (lo + hi) / 2
+        if abs(cascade_response(sections, mid)) > target:
+            lo = mid
+        else:
+            hi = mid
+    return lo * fs / (2 * math.pi)
+
+
+def header(args, ideal, out):
+    guard = args.name + '_h'
+    command = ' '.join(['filter_design.py'] + sys.argv[1:])
+    lines = [
+        '// Generated by %s' % command,
+        '// %s low pass, order %d, fs %g Hz, fc %g Hz, Q%d coefficients'
+        % (args.type, args.order, args.fs, args.fc, args.frac),
+        '',
+        '#ifndef %s' % guard,
+        '#define %s' % guard,
+        '#include <SignalFilter.h>',
+        '',
+    ]
+    names = []
+    for i, s in enumerate(ideal):
+        b, a = s.quantized(args.frac)
+        name = '%s_S%d' % (args.name, i + 1)
+        names.append(name)
+        lines.append('// b = %.10f %.10f %.10f, a = %.10f %.10f' % tuple(s.b + s.a))
+        lines.append('typedef SignalFilterBiquad<%d, %d, %d, %d, %d, %d> %s;'
+                     % (b[0], b[1], b[2], a[0], a[1], args.frac, name))
+    lines += [
+        '',
+        'typedef SignalFilterCascade<%s> %s;' % (', '.join(names), args.name),
+        '',
+        '#endif',
+        '',
+    ]
+    out.write('\n'.join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[1],
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--type', choices=['butterworth', 'bessel', 'chebyshev'],
+                        default='butterworth')
+    parser.add_argument('--order', type=int, default=2)
+    parser.add_argument('--fs', type=float, required=True, help='sample rate, Hz')
+    parser.add_argument('--fc', type=float, required=True,
+                        help='cutoff, Hz: -3 dB point, passband (ripple) edge for Chebyshev')
+    parser.add_argument('--ripple', type=float, default=1.0,
+                        help='Chebyshev passband ripple, dB')
+    parser.add_argument('--frac', type=int, default=14,
+                        help='coefficient fraction bits (SIGNAL_FILTER_FRAC)')
+    parser.add_argument('--input-bits', type=int, default=13,
+                        help='input range, 13 for the oversampled ADC')
+    parser.add_argument('--name', default='DesignedFilter', help='C++ type name')
+    parser.add_argument('--output', help='header file (stdout if omitted)')
+    args = parser.parse_args()
+
+    if args.order < 1 or not 0 < args.fc < args.fs / 2:
+        parser.error('need order >= 1 and 0 < fc < fs/2')
+
+    ideal = design(args)
+    quant = quantized_sections(ideal, args.frac)
+    ok = report(args, ideal, quant, sys.stderr)
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            header(args, ideal, f)
+    else:
+        header(args, ideal, sys.stdout)
+    return 0 if ok else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
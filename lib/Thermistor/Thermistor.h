@@ -0,0 +1,123 @@
+/*********************************************************************
+NTC thermistor to temperature conversion with a lookup table built at
+compile time.
+
+The thermistor is the low side of a divider with a series resistor to
+Vref, so R = SERIES * adc / (full scale - adc). The Beta equation
+
+  1/T = 1/T0 + ln(R/R0) / B
+
+is evaluated by the compiler for THERMISTOR_TABLE_SIZE evenly spaced ADC
+values and stored in PROGMEM as deci-degrees Celsius. At run time a
+conversion is one table read and a linear interpolation, no floating
+point and no division.
+
+  typedef Thermistor<10000, 100000, 3950> Sensor;   // series, R0, B
+  int16_t t = Sensor::toDeciCelsius(analogRead(pin) << 6);
+
+The input is the ADC reading scaled to 16 bits (0..65535 full scale), so
+10 bit and oversampled readings use the same table.
+*********************************************************************/
+#ifndef THERMISTOR_H
+#define THERMISTOR_H
+
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include <avr/pgmspace.h>
+
+#define THERMISTOR_TABLE_BITS   7                           // 128 segments
+#define THERMISTOR_TABLE_SIZE   ((1 << THERMISTOR_TABLE_BITS) + 1)
+#define THERMISTOR_STEP_BITS    (16 - THERMISTOR_TABLE_BITS)
+#define THERMISTOR_STEP_MASK    ((1 << THERMISTOR_STEP_BITS) - 1)
+
+// the table is clamped to this range (deci-degrees)
+#define THERMISTOR_TEMP_MIN     (-400)
+#define THERMISTOR_TEMP_MAX     3000
+
+
+// C++11 constexpr functions are single expressions, hence the recursion.
+
+// ln(m) = 2 * (y + y^3/3 + y^5/5 + ...) with y = (m-1)/(m+1), m in [1, 2)
+constexpr double thermistorLnSeries(double y2, double p, uint8_t k) {
+  return (k > 20) ? 0.0 : p / (2 * k + 1) + thermistorLnSeries(y2, p * y2, k + 1);
+}
+
+// ln(x) = k * ln(2) + ln(m), x = m * 2^k, x > 0
+constexpr double thermistorLn(double x, int8_t k = 0) {
+  return (x >= 2.0) ? thermistorLn(x / 2.0, k + 1) :
+         (x < 1.0)  ? thermistorLn(x * 2.0, k - 1) :
+         k * 0.69314718055994531 +
+           2.0 * thermistorLnSeries(((x - 1.0) / (x + 1.0)) * ((x - 1.0) / (x + 1.0)),
+                                    (x - 1.0) / (x + 1.0), 0);
+}
+
+constexpr int16_t thermistorClamp(double deci) {
+  return (deci >= THERMISTOR_TEMP_MAX) ? THERMISTOR_TEMP_MAX :
+         (deci <= THERMISTOR_TEMP_MIN) ? THERMISTOR_TEMP_MIN :
+         (int16_t)((deci >= 0) ? deci + 0.5 : deci - 0.5);
+}
+
+// Beta equation for a 16 bit scaled ADC value, in deci-degrees
+constexpr int16_t thermistorDeciCelsius(uint32_t series, uint32_t nominal, uint16_t beta,
+                                        int16_t nominalTemp, uint32_t adc16) {
+  return (adc16 == 0)      ? THERMISTOR_TEMP_MAX :
+         (adc16 >= 65536L) ? THERMISTOR_TEMP_MIN :
+         thermistorClamp((1.0 / (1.0 / (nominalTemp + 273.15) +
+                                 thermistorLn((double)series * adc16 / (65536.0 - adc16) / nominal) / beta)
+                          - 273.15) * 10.0);
+}
+
+
+template <uint16_t... Is> struct ThermistorIndices {};
+
+template <uint16_t N, uint16_t... Is>
+struct ThermistorMakeIndices : ThermistorMakeIndices<N - 1, N - 1, Is...> {};
+
+template <uint16_t... Is>
+struct ThermistorMakeIndices<0, Is...> {
+  typedef ThermistorIndices<Is...> type;
+};
+
+template <uint32_t SERIES, uint32_t NOMINAL, uint16_t BETA, int16_t NOMINAL_TEMP, class I>
+struct ThermistorTable;
+
+template <uint32_t SERIES, uint32_t NOMINAL, uint16_t BETA, int16_t NOMINAL_TEMP, uint16_t... Is>
+struct ThermistorTable<SERIES, NOMINAL, BETA, NOMINAL_TEMP, ThermistorIndices<Is...> > {
+  static const int16_t values[sizeof...(Is)];
+};
+
+template <uint32_t SERIES, uint32_t NOMINAL, uint16_t BETA, int16_t NOMINAL_TEMP, uint16_t... Is>
+const int16_t ThermistorTable<SERIES, NOMINAL, BETA, NOMINAL_TEMP, ThermistorIndices<Is...> >::values[sizeof...(Is)] PROGMEM = {
+  thermistorDeciCelsius(SERIES, NOMINAL, BETA, NOMINAL_TEMP, (uint32_t)Is << THERMISTOR_STEP_BITS)...
+};
+
+
+// SERIES and NOMINAL in ohms, BETA in K, NOMINAL_TEMP (temperature of NOMINAL) in C
+template <uint32_t SERIES, uint32_t NOMINAL, uint16_t BETA, int16_t NOMINAL_TEMP = 25>
+class Thermistor {
+  public:
+    typedef ThermistorTable<SERIES, NOMINAL, BETA, NOMINAL_TEMP,
+                            typename ThermistorMakeIndices<THERMISTOR_TABLE_SIZE>::type> Table;
+
+    // adc16: ADC reading scaled to 16 bits. Returns deci-degrees Celsius
+    static int16_t toDeciCelsius(uint16_t adc16) {
+      const int16_t *entry = Table::values + (adc16 >> THERMISTOR_STEP_BITS);
+      int16_t t0 = pgm_read_word(entry);
+      int16_t t1 = pgm_read_word(entry + 1);
+
+      return t0 + (int16_t)(((int32_t)(t1 - t0) * (adc16 & THERMISTOR_STEP_MASK)) >> THERMISTOR_STEP_BITS);
+    }
+
+    // reference Beta equation in floating point, for accuracy checks
+    static double referenceCelsius(double adc16) {
+      double r = SERIES * adc16 / (65536.0 - adc16);
+
+      return 1.0 / (1.0 / (NOMINAL_TEMP + 273.15) + log(r / NOMINAL) / BETA) - 273.15;
+    }
+};
+
+#endif  // THERMISTOR_H
@@ -0,0 +1,77 @@
+/*********************************************************************
+Speed and accuracy of the Thermistor lookup table.
+
+Prints the CPU cycles per conversion of the table and of the floating
+point Beta equation, then the table error against the Beta equation over
+the whole 10 bit ADC range (every 32 counts, plus the worst case between
+-10 and 120 C).
+*********************************************************************/
+
+#include <Thermistor.h>
+
+typedef Thermistor<10000, 100000, 3950> Sensor;   // series, R0 at 25 C, B
+
+#define RUNS 1000
+
+volatile int16_t sink;
+volatile double fsink;
+
+// average CPU cycles per conversion
+unsigned long cyclesTable() {
+  unsigned long start = micros();
+
+  for (uint16_t i=0; i<RUNS; i++) {
+    sink = Sensor::toDeciCelsius((i & 1023) << 6);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+unsigned long cyclesFloat() {
+  unsigned long start = micros();
+
+  for (uint16_t i=0; i<RUNS; i++) {
+    fsink = Sensor::referenceCelsius(((i & 1023) | 1) << 6);
+  }
+  return (micros() - start) * (F_CPU / 1000000L) / RUNS;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  Serial.print(F("table: "));
+  Serial.print(cyclesTable());
+  Serial.print(F(" cycles, float Beta: "));
+  Serial.print(cyclesFloat());
+  Serial.println(F(" cycles"));
+
+  Serial.println(F("adc\ttable\tbeta\terror (C)"));
+  double worst = 0;
+  uint16_t worstAdc = 0;
+
+  for (uint16_t adc=1; adc<1024; adc++) {
+    double table = Sensor::toDeciCelsius(adc << 6) / 10.0;
+    double beta = Sensor::referenceCelsius(adc << 6);
+
+    if (beta >= -10 && beta <= 120 && fabs(table - beta) > worst) {
+      worst = fabs(table - beta);
+      worstAdc = adc;
+    }
+    if ((adc & 31) == 0) {
+      Serial.print(adc);
+      Serial.print('\t');
+      Serial.print(table, 1);
+      Serial.print('\t');
+      Serial.print(beta, 2);
+      Serial.print('\t');
+      Serial.println(table - beta, 2);
+    }
+  }
+
+  Serial.print(F("worst error between -10 and 120 C: "));
+  Serial.print(worst, 2);
+  Serial.print(F(" C at adc "));
+  Serial.println(worstAdc);
+}
+
+void loop() {
+}
@@ -3,62 +3,77 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>     //see https://github.com/adafruit/Adafruit-GFX-Library
 #include <Adafruit_SSD1306.h> //see https://github.com/adafruit/Adafruit_SSD1306
-#include <math.h>
+#include <SSD1306_Display.h>
 #include <HydroStoveDisplay.h>
+#include <TextFormatter.h>
 
 
 #define LCD_YELLOW  16
 
+//zona de la gráfica, bajo la franja amarilla
+#define GRAPH_TOP     LCD_YELLOW
+#define GRAPH_HEIGHT  (HydroStoveLCD::LOGICAL_HEIGHT - LCD_YELLOW)
 
-// Inicializa el display y variables
+
+// Inicializa las variables. No toca el bus: el objeto es global y se construye
+// antes que init() de Arduino
 HydroStoveDisplay::HydroStoveDisplay(){
+  //clear buffer
+  for (int i=0; i<HydroStoveLCD::LOGICAL_WIDTH; i++){
+    _buffer[i] = 0;
+  }
+}
+
+
+// Inicializa el display. Llamar desde setup(): el TWI en modo polling espera sin
+// límite, mejor con la placa ya arrancada
+void HydroStoveDisplay::begin(){
   _display.begin(SSD1306_SWITCHCAPVCC, 0x3C);  // initialize with the I2C addr 0x3D (for the 128x64)
   _display.setTextColor(WHITE);
   _display.setCursor(0,0);
   _display.clearDisplay();
   _display.println("Inicializado!");
   _display.display();
-
-  //clear buffer
-  for (int i=0; i<SSD1306_LCDWIDTH; i++){
-    _buffer[i] = 0;
-  }
+  _lastActivity = millis();
+  _lastBusTime  = millis();
 }
 
 
 /**
   Añade un nuevo valor al buffer (potencia instantánea) y refresca la pantalla
   Parámetros:
-  tempIn: temperatura de entrada al sistema
-  tempOut: temperatura de salida del sistema
-  flowRate: caudal en l/s
+  tempIn: temperatura de entrada al sistema (décimas de ºC)
+  tempOut: temperatura de salida del sistema (décimas de ºC)
+  flowRate: caudal en ml/s
+  power: potencia media (W) desde la columna anterior, p.ej. HeatEnergy::takeMeanPowerW().
+         Cada medida del caudalímetro pesa según su duración. Se satura a 16 bits
 
   Return: valor de reescalado. Si se desea mantener la escala temporal en la gráfica,
           el periodo debe multiplicarse por este valor. Es decir, si al inicio
           se incorpora un valor cada 5 segundos, con un reescalado de 2 deberán
           incorporarse cada 10, 3 cada 15 y así sucesivamente.
   **/
-unsigned int HydroStoveDisplay::add(unsigned int tempIn, unsigned int tempOut, unsigned long flowRate){
-  unsigned int power;
-
-  if (_bufferIndex >= SSD1306_LCDWIDTH){
+unsigned int HydroStoveDisplay::add(int tempIn, int tempOut, unsigned int flowRate, uint32_t power){
+  if (_bufferIndex >= HydroStoveLCD::LOGICAL_WIDTH){
     unsigned int i=0, j=0;
     _scale++;
 
     //comprime los valores a la mitad del buffer
     //TODO: comprimir para que solo hay que liberar 1 hueco, y que un parámetro sea el tiempo desde la última vez que se llamó (tick). De esta forma, el ancho sería la suma del tiempo de todas las muestras capturadas, la gráfica se construye uniendo puntos con líneas (en lugar de barras verticales), y para comprimir se buscar la pareja de valores consecutivos con menor diferencia y se elimina uno de ellos.
     while (i<_bufferIndex){
-      _buffer[j++] = floor( (_buffer[i++] + _buffer[i++])/2 );
+      _buffer[j++] = ((uint32_t)_buffer[i] + _buffer[i+1]) / 2;   //sin desbordar 16 bits
+      i += 2;
     }
     _bufferIndex = j;
+    _redraw = true;
   }
 
-  //Añade un nuevo valor de potencia instantánea al buffer
-  power = CALOR_ESPECIF_AGUA * flowRate * (tempOut-tempIn);
-  _buffer[_bufferIndex++] = power;
+  //Añade un nuevo valor de potencia media al buffer
+  unsigned int watts = heatSaturate16(power);
+  _buffer[_bufferIndex++] = watts;
 
-  if (power > _maxValue){
-    _maxValue = power;
+  if (watts > _maxValue){
+    _maxValue = watts;
   }
 
   _currentTempIn    = tempIn;
@@ -69,37 +84,131 @@ unsigned int HydroStoveDisplay::add(unsigned int tempIn, unsigned int tempOut, u
 }
 
 
+/**
+  Energía acumulada en Wh (ver HeatEnergy). Se muestra en kWh con un decimal,
+  así que solo repinta cuando cambian esos 100 Wh.
+  **/
+void HydroStoveDisplay::setEnergy(uint64_t wh){
+  _currentEnergy = wh > 0xFFFFFFFFUL ? 0xFFFFFFFFUL : (uint32_t)wh;
+}
+
+
+/**
+  Repinta la pantalla. La gráfica solo crece por la derecha, así que normalmente
+  basta con pintar las columnas nuevas; se repinta entera cuando cambia la
+  escala vertical o se comprime el buffer.
+  En modo paginado (LCD_BUFFER_PAGES) no hay framebuffer completo y se repinta
+  todo por franjas desde drawPage().
+  **/
 void HydroStoveDisplay::refreshDisplay(){
   if (_bufferIndex <=0){
     return;
   }
 
-  _display.clearDisplay();
+  //pantalla apagada: no se pinta hasta wake()
+  updateState();
+  if (_state == DISPLAY_STATE_OFF){
+    return;
+  }
+
+  //el frame anterior aún se está enviando, no se puede pintar sobre el buffer
+  if (_display.isBusy()){
+    return;
+  }
+
+  if (!hasChanged()){
+    return;
+  }
+
+  //reescala con un 25% de margen para no repintar con cada nuevo máximo
+  if (_maxValue > _graphMax){
+    uint32_t graphMax = (uint32_t)_maxValue + _maxValue/4;  //en 32 bits, la potencia satura a 65535
+    _graphMax = graphMax > 0xFFFF ? 0xFFFF : graphMax;
+    _redraw = true;
+  }
+
+  //altura por unidad de potencia en Q16, una sola división por frame
+  _graphScale = ((uint32_t)GRAPH_HEIGHT << 16) / (_graphMax ? _graphMax : 1);
+
+  _shownTempIn   = _currentTempIn;
+  _shownTempOut  = _currentTempOut;
+  _shownFlowRate = _currentFlowRate;
+  _shownPower    = _buffer[_bufferIndex-1];
+  _shownEnergy   = _currentEnergy;
+  _shownWarning  = _warning;
+
+  if (HydroStoveLCD::PAGED){
+    _display.drawPages(drawPage, this);
+    _drawnIndex = _bufferIndex;
+    _redraw = false;
+    return;
+  }
+
+  _display.fillRect(0, 0, _display.width(), LCD_YELLOW, BLACK);
+  drawHeader();
+
+  if (_redraw){
+    _display.fillRect(0, GRAPH_TOP, _display.width(), GRAPH_HEIGHT, BLACK);
+    _drawnIndex = 0;
+    _redraw = false;
+  }
+  drawGraph(_drawnIndex);
+  _drawnIndex = _bufferIndex;
+
+  _display.display();
+}
+
+
+//modo paginado: se llama una vez por franja y pinta la pantalla entera
+void HydroStoveDisplay::drawPage(void *context){
+  HydroStoveDisplay *self = (HydroStoveDisplay *)context;
+
+  self->drawHeader();
+  self->drawGraph(0);
+}
+
+
+//temperaturas, caudal, potencia y aviso en la franja amarilla
+void HydroStoveDisplay::drawHeader(){
   _display.setTextSize(1);
   _display.setTextColor(WHITE);
-  _display.setCursor(0,0);
-  _display.println(String(_currentTempIn) + " ºC " +
-                   String(_currentTempOut) + " ºC " +
-                   String(_currentFlowRate*3600) + " l/h" +
-                   String(_buffer[_bufferIndex-1]) + " W");
 
-  for (uint8_t x=0; x<= _bufferIndex; x++){
-    int16_t y;
+  //texto en la pila, sin String para no fragmentar el heap
+  char line[HydroStoveLCD::LOGICAL_WIDTH/6 + 1];
+  TextFormatter text(line, sizeof(line));
 
-    y = floor(_buffer[x]*LCD_YELLOW / _maxValue);
-    _display.drawLine(x, y, x, SSD1306_LCDHEIGHT-1, WHITE);
-  }
+  text.printInt(_currentTempIn/10).print_P(UNIT_CELSIUS).print(' ')
+      .printInt(_currentTempOut/10).print_P(UNIT_CELSIUS).print(' ')
+      .printUInt((uint32_t)_currentFlowRate*36/10).print_P(UNIT_LITRES_HOUR);
+  _display.setCursor(0,0);
+  _display.print(line);
+
+  text.clear();
+  text.printUInt(_buffer[_bufferIndex-1]).print(' ').print_P(UNIT_WATT).print(' ')
+      .printFixed(min(_currentEnergy/100, 0x7FFFFFFFUL), 1).print_P(UNIT_KILOWATT_HOUR);
+  _display.setCursor(0,8);
+  _display.print(line);
 
   if (_warning){
-      _display.drawBitmap(0,
-                          _display.width()-WARNING_SMALL_ICON_SIZE,
+      _display.drawBitmap(_display.width()-WARNING_SMALL_ICON_SIZE,
+                          0,
                           warningSmallIcon,
                           WARNING_SMALL_ICON_SIZE,
                           WARNING_SMALL_ICON_SIZE,
                           WHITE);
   }
+}
 
-  _display.display();
+
+//barras de la gráfica desde la columna from hasta la última muestra
+void HydroStoveDisplay::drawGraph(unsigned int from){
+  for (unsigned int x=from; x<_bufferIndex; x++){
+    uint8_t h = ((uint32_t)_buffer[x] * _graphScale) >> 16;
+
+    if (h){
+      _display.drawFastVLine(x, HydroStoveLCD::LOGICAL_HEIGHT-h, h, WHITE);
+    }
+  }
 }
 
 
@@ -118,6 +227,109 @@ bool HydroStoveDisplay::getWarning(){
 }
 
 
+//un aviso nuevo enciende la pantalla
 void HydroStoveDisplay::setWarning(bool b){
+  if (b && !_warning){
+    wake();
+  }
   _warning = b;
 }
+
+
+static unsigned int difference(unsigned int a, unsigned int b){
+  return a > b ? a - b : b - a;
+}
+
+static unsigned int difference(int a, int b){
+  return a > b ? (unsigned int)(a - b) : (unsigned int)(b - a);
+}
+
+
+/**
+  Indica si hay que repintar: ha llegado una columna nueva a la gráfica, cambia
+  la escala o el aviso, o algún valor mostrado ha variado al menos su umbral.
+  Con umbrales 0 se repinta siempre (sin gobernador).
+  **/
+bool HydroStoveDisplay::hasChanged(){
+  return _redraw ||
+         _drawnIndex != _bufferIndex ||
+         _maxValue > _graphMax ||
+         _warning != _shownWarning ||
+         difference(_currentTempIn, _shownTempIn) >= _tempThreshold ||
+         difference(_currentTempOut, _shownTempOut) >= _tempThreshold ||
+         difference(_currentFlowRate, _shownFlowRate) >= _flowThreshold ||
+         difference(_buffer[_bufferIndex-1], _shownPower) >= _powerThreshold ||
+         _currentEnergy/100 != _shownEnergy/100;
+}
+
+
+//atenúa y después apaga la pantalla tras un tiempo sin pulsaciones ni avisos
+void HydroStoveDisplay::updateState(){
+  unsigned long idle = millis() - _lastActivity;
+
+  if (_state == DISPLAY_STATE_ON && _dimTimeout && idle >= _dimTimeout){
+    _display.dim(true);
+    _state = DISPLAY_STATE_DIM;
+  }
+  if (_state != DISPLAY_STATE_OFF && _offTimeout && idle >= _offTimeout){
+    _display.command(SSD1306_DISPLAYOFF);
+    _state = DISPLAY_STATE_OFF;
+  }
+}
+
+
+/**
+  Umbrales de cambio para repintar: temperaturas en décimas de ºC, caudal en
+  ml/s y potencia en W, las mismas unidades que add(). 0 repinta en cada llamada a refreshDisplay().
+  **/
+void HydroStoveDisplay::setRefreshThresholds(unsigned int temp, unsigned int flow, unsigned int power){
+  _tempThreshold  = temp;
+  _flowThreshold  = flow;
+  _powerThreshold = power;
+}
+
+
+//tiempos de inactividad en ms hasta atenuar y apagar la pantalla. 0 desactiva
+void HydroStoveDisplay::setSleepTimeouts(unsigned long dimAfter, unsigned long offAfter){
+  _dimTimeout = dimAfter;
+  _offTimeout = offAfter;
+}
+
+
+//enciende la pantalla con el brillo normal (pulsador o aviso)
+void HydroStoveDisplay::wake(){
+  _lastActivity = millis();
+
+  if (_state == DISPLAY_STATE_OFF){
+    _display.command(SSD1306_DISPLAYON);
+  }
+  if (_state != DISPLAY_STATE_ON){
+    _display.dim(false);
+  }
+  _state = DISPLAY_STATE_ON;
+}
+
+
+uint8_t HydroStoveDisplay::getState(){
+  return _state;
+}
+
+
+/**
+  Ocupación del bus I2C en tanto por mil desde la llamada anterior, estimada
+  con 9 bits por byte al reloj del bus.
+  **/
+uint16_t HydroStoveDisplay::busLoad(){
+  uint32_t bytes = _display.getBusBytes() - _lastBusBytes;
+  unsigned long ms = millis() - _lastBusTime;
+  uint16_t load = 0;
+
+  if (ms){
+    //en 64 bits: bytes * 9000 desborda 32 bits pasados ~477 kB
+    load = ((uint64_t)bytes * 9000UL) / ((uint64_t)(_display.getI2CClock() / 1000) * ms);
+  }
+  _lastBusBytes = _display.getBusBytes();
+  _lastBusTime  = millis();
+
+  return load;
+}
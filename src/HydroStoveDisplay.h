@@ -13,13 +13,41 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>     //see https://github.com/adafruit/Adafruit-GFX-Library
 #include <Adafruit_SSD1306.h> //see https://github.com/adafruit/Adafruit_SSD1306
+#include <SSD1306_Display.h>
+#include <HeatMeter.h>
 
-#if (SSD1306_LCDHEIGHT != 64)
-#error("Height incorrect, please fix Adafruit_SSD1306.h!");
+//geometría del panel. Para una pantalla 128x32: -D LCD_HEIGHT=32 en platformio.ini
+#ifndef LCD_WIDTH
+#define LCD_WIDTH   128
+#endif
+#ifndef LCD_HEIGHT
+#define LCD_HEIGHT  64
+#endif
+#ifndef LCD_ROTATION
+#define LCD_ROTATION  0
+#endif
+
+//páginas de 8 filas en RAM. Con -D LCD_BUFFER_PAGES=1 se pinta por franjas
+//y el framebuffer ocupa 128 bytes en lugar de 1 KB, a cambio de repintar
+//y enviar la pantalla entera en cada refresco
+#ifndef LCD_BUFFER_PAGES
+#define LCD_BUFFER_PAGES  (LCD_HEIGHT/8)
 #endif
 
+typedef SSD1306_Display<LCD_WIDTH, LCD_HEIGHT, LCD_ROTATION, LCD_BUFFER_PAGES> HydroStoveLCD;
 
-#define CALOR_ESPECIF_AGUA  418    // J/K·kg
+
+//estado de la pantalla (gobernador de refresco)
+#define DISPLAY_STATE_ON    0
+#define DISPLAY_STATE_DIM   1
+#define DISPLAY_STATE_OFF   2
+
+//umbrales por defecto para repintar (décimas de ºC, ml/s, W) y tiempos de inactividad (ms)
+#define DEFAULT_TEMP_THRESHOLD    10
+#define DEFAULT_FLOW_THRESHOLD    5
+#define DEFAULT_POWER_THRESHOLD   50
+#define DEFAULT_DIM_TIMEOUT       60000UL
+#define DEFAULT_OFF_TIMEOUT       300000UL
 
 const unsigned char PROGMEM test[] = {
   B10000000, B0000010,
@@ -74,24 +102,65 @@ const unsigned char PROGMEM warningBigIcon [] = {
 class HydroStoveDisplay {
   public:
     HydroStoveDisplay ();
+    void begin();                           //inicializa la pantalla, desde setup()
 
     //añade un nuevo valor al buffer. No repinta
-    unsigned int add(unsigned int tempIn, unsigned int tempOut, unsigned long flowRate);
+    unsigned int add(int tempIn, int tempOut, unsigned int flowRate, uint32_t power);
+    //energía acumulada (Wh) que se muestra en la cabecera
+    void setEnergy(uint64_t wh);
     void refreshDisplay();
     void setWarning(bool w);
     bool getWarning();
     void showBigWarning();
 
+    //gobernador de refresco
+    void setRefreshThresholds(unsigned int temp, unsigned int flow, unsigned int power);
+    void setSleepTimeouts(unsigned long dimAfter, unsigned long offAfter);
+    void wake();
+    uint8_t getState();
+    uint16_t busLoad();
+
 
   private:
-    Adafruit_SSD1306 _display;
+    HydroStoveLCD _display;
     unsigned int _bufferIndex = 0;
-    unsigned int _buffer[SSD1306_LCDWIDTH];
-    unsigned int _currentTempIn, _currentTempOut, _currentFlowRate;
+    unsigned int _buffer[HydroStoveLCD::LOGICAL_WIDTH];
+    int _currentTempIn, _currentTempOut;    //décimas de ºC
+    unsigned int _currentFlowRate;          //ml/s
+    uint32_t _currentEnergy = 0;            //Wh, saturado a 32 bits
     unsigned int _scale = 1;
     unsigned int _maxValue = 0;
     bool _warning = false;
 
+    //estado de la gráfica ya pintada en el framebuffer
+    unsigned int _drawnIndex = 0;           //columnas ya pintadas
+    unsigned int _graphMax = 0;             //potencia correspondiente a la altura máxima
+    uint32_t _graphScale = 0;               //altura por unidad de potencia (Q16)
+    bool _redraw = true;                    //hay que repintar la gráfica entera
+
+    //gobernador: valores en pantalla, umbrales y estado
+    int _shownTempIn = 0, _shownTempOut = 0;
+    unsigned int _shownFlowRate = 0, _shownPower = 0;
+    uint32_t _shownEnergy = 0;
+    bool _shownWarning = false;
+    unsigned int _tempThreshold = DEFAULT_TEMP_THRESHOLD;
+    unsigned int _flowThreshold = DEFAULT_FLOW_THRESHOLD;
+    unsigned int _powerThreshold = DEFAULT_POWER_THRESHOLD;
+    unsigned long _dimTimeout = DEFAULT_DIM_TIMEOUT;
+    unsigned long _offTimeout = DEFAULT_OFF_TIMEOUT;
+    unsigned long _lastActivity = 0;
+    uint8_t _state = DISPLAY_STATE_ON;
+
+    //medida de ocupación del bus
+    uint32_t _lastBusBytes = 0;
+    unsigned long _lastBusTime = 0;
+
+    bool hasChanged();
+    void updateState();
+    static void drawPage(void *context);
+    void drawHeader();
+    void drawGraph(unsigned int from);
+
 };
 
 #endif  // HYDROSTOVE_DISPLAY_H
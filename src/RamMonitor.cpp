@@ -0,0 +1,61 @@
+#include <RamMonitor.h>
+
+
+#define RAM_CANARY  0xC5
+
+extern uint8_t _end;              //final de .bss, definido por el linker
+extern uint8_t __stack;           //RAMEND
+extern char *__brkval;            //final del heap, 0 si nunca se ha llamado a malloc
+extern char *__malloc_heap_start;
+
+
+/**
+  Se ejecuta antes que el startup de avr-libc (r1 aún no vale 0), por eso en
+  ensamblador y sin prólogo.
+  **/
+void ramPaint() __attribute__ ((naked, used, section (".init1")));
+
+void ramPaint(){
+  __asm volatile ("    ldi r30,lo8(_end)\n"
+                  "    ldi r31,hi8(_end)\n"
+                  "    ldi r24,%0\n"
+                  "    ldi r25,hi8(__stack)\n"
+                  "    rjmp 2f\n"
+                  "1:\n"
+                  "    st Z+,r24\n"
+                  "2:\n"
+                  "    cpi r30,lo8(__stack)\n"
+                  "    cpc r31,r25\n"
+                  "    brlo 1b\n"
+                  "    breq 1b"
+                  :: "M" (RAM_CANARY));
+}
+
+
+static uint8_t *heapEnd(){
+  return __brkval ? (uint8_t *)__brkval : &_end;
+}
+
+
+uint16_t ramHighWaterFree(){
+  const uint8_t *p = heapEnd();
+  uint16_t count = 0;
+
+  while (p <= &__stack && *p == RAM_CANARY){
+    p++;
+    count++;
+  }
+  return count;
+}
+
+
+uint16_t ramFree(){
+  uint8_t top;
+
+  return &top - heapEnd();
+}
+
+
+uint16_t ramHeapUsed(){
+  return __brkval ? __brkval - __malloc_heap_start : 0;
+}
@@ -0,0 +1,28 @@
+#ifndef RAM_MONITOR_H
+#define RAM_MONITOR_H
+
+// Compatibility with the Arduino 1.0 library standard
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+
+/**
+  Marca de agua de la RAM libre. Al arrancar (sección .init1, antes de
+  inicializar variables) se pinta con un patrón toda la RAM entre el final
+  de .bss y el final de la pila. La pila y el heap van borrando el patrón, así
+  que los bytes que aún lo conservan son la RAM que nunca se ha usado.
+  **/
+
+//bytes que nunca ha usado ni la pila ni el heap desde el arranque
+uint16_t ramHighWaterFree();
+
+//RAM libre ahora mismo entre el heap (o .bss) y la pila
+uint16_t ramFree();
+
+//bytes reservados alguna vez con malloc (0 si nunca se ha usado el heap)
+uint16_t ramHeapUsed();
+
+#endif  // RAM_MONITOR_H
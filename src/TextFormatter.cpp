@@ -0,0 +1,140 @@
+#include <TextFormatter.h>
+
+
+const char UNIT_CELSIUS[] PROGMEM       = "\xF7" "C";
+const char UNIT_LITRES_HOUR[] PROGMEM   = "l/h";
+const char UNIT_WATT[] PROGMEM          = "W";
+const char UNIT_KILOWATT_HOUR[] PROGMEM = "kWh";
+
+
+TextFormatter::TextFormatter(char *buffer, uint8_t size){
+  _buffer = buffer;
+  _size   = size;
+  clear();
+}
+
+
+void TextFormatter::clear(){
+  _length = 0;
+  if (_size){
+    _buffer[0] = '\0';
+  }
+}
+
+
+TextFormatter& TextFormatter::print(char c){
+  if (_length + 1 < _size){
+    _buffer[_length++] = c;
+    _buffer[_length] = '\0';
+  }
+  return *this;
+}
+
+
+TextFormatter& TextFormatter::print(const char *s){
+  while (*s){
+    print(*s++);
+  }
+  return *this;
+}
+
+
+TextFormatter& TextFormatter::print_P(PGM_P s){
+  char c;
+
+  while ((c = pgm_read_byte(s++))){
+    print(c);
+  }
+  return *this;
+}
+
+
+/**
+  El AVR no divide por hardware y __udivmodsi4 tarda ~600 ciclos por dígito.
+  Se divide por 10 multiplicando por el recíproco: con desplazamientos y sumas
+  en 32 bits y con un producto de 16x16 bits en cuanto el valor cabe en 16.
+  **/
+uint8_t TextFormatter::toDigits(uint32_t value, char *digits){
+  uint8_t n = 0;
+
+  while (value > 0xFFFF){
+    uint32_t q = (value >> 1) + (value >> 2);
+    q += q >> 4;
+    q += q >> 8;
+    q += q >> 16;
+    q >>= 3;
+
+    uint8_t r = value - ((q << 3) + (q << 1));
+    if (r > 9){
+      q++;
+      r -= 10;
+    }
+    digits[n++] = '0' + r;
+    value = q;
+  }
+
+  uint16_t v = value;
+  do {
+    uint16_t q = ((uint32_t)v * 0xCCCD) >> 19;
+    digits[n++] = '0' + (v - q*10);
+    v = q;
+  } while (v);
+
+  return n;
+}
+
+
+TextFormatter& TextFormatter::printUInt(uint32_t value){
+  char digits[10];
+  uint8_t n = toDigits(value, digits);
+
+  while (n){
+    print(digits[--n]);
+  }
+  return *this;
+}
+
+
+TextFormatter& TextFormatter::printInt(int32_t value){
+  if (value < 0){
+    print('-');
+    return printUInt(-(uint32_t)value);
+  }
+  return printUInt(value);
+}
+
+
+TextFormatter& TextFormatter::printFixed(int32_t value, uint8_t decimals){
+  char digits[10];
+  uint32_t v = value;
+  uint8_t n;
+
+  if (value < 0){
+    print('-');
+    v = -(uint32_t)value;
+  }
+
+  //ceros a la izquierda hasta tener al menos una cifra entera
+  n = toDigits(v, digits);
+  while (n <= decimals && n < sizeof(digits)){
+    digits[n++] = '0';
+  }
+
+  while (n){
+    if (n == decimals){
+      print('.');
+    }
+    print(digits[--n]);
+  }
+  return *this;
+}
+
+
+const char *TextFormatter::c_str(){
+  return _buffer;
+}
+
+
+uint8_t TextFormatter::length(){
+  return _length;
+}
@@ -0,0 +1,57 @@
+#ifndef TEXT_FORMATTER_H
+#define TEXT_FORMATTER_H
+
+// Compatibility with the Arduino 1.0 library standard
+#if defined(ARDUINO) && ARDUINO >= 100
+#include "Arduino.h"
+#else
+#include "WProgram.h"
+#endif
+
+#include <avr/pgmspace.h>
+
+
+//sufijos de unidades en flash. 0xF7 es el símbolo de grado en la fuente
+//de Adafruit_GFX (sin cp437)
+extern const char UNIT_CELSIUS[] PROGMEM;
+extern const char UNIT_LITRES_HOUR[] PROGMEM;
+extern const char UNIT_WATT[] PROGMEM;
+extern const char UNIT_KILOWATT_HOUR[] PROGMEM;
+
+
+/**
+  Formatea texto sobre un buffer del llamador (normalmente en la pila), sin
+  usar el heap. Si el texto no cabe se trunca; el buffer siempre queda
+  terminado en '\0'.
+
+    char line[22];
+    TextFormatter f(line, sizeof(line));
+    f.printInt(tempIn).print_P(UNIT_CELSIUS);
+  **/
+class TextFormatter {
+  public:
+    TextFormatter(char *buffer, uint8_t size);
+
+    void clear();
+    TextFormatter& print(char c);
+    TextFormatter& print(const char *s);
+    TextFormatter& print_P(PGM_P s);
+    TextFormatter& printUInt(uint32_t value);
+    TextFormatter& printInt(int32_t value);
+
+    //value en unidades de 10^-decimals, p.ej. printFixed(1234, 1) -> "123.4"
+    TextFormatter& printFixed(int32_t value, uint8_t decimals);
+
+    const char *c_str();
+    uint8_t length();
+
+  private:
+    char *_buffer;
+    uint8_t _size;
+    uint8_t _length;
+
+    //escribe los dígitos de value al revés en digits, devuelve cuántos
+    static uint8_t toDigits(uint32_t value, char *digits);
+};
+
+#endif  // TEXT_FORMATTER_H
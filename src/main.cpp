@@ -32,8 +32,15 @@ Loop:
 #include <Arduino.h>
 #include <SignalFilter.h>     //see https://github.com/jeroendoggen/Arduino-signal-filtering-library
 #include <FlowMeter.h>        //see https://github.com/sekdiy/FlowMeter
-#include <main.h>
+#include <FlowMeterCounter.h>
+#include <FlowMeterCapture.h>
+#include <FlowMeterPinChange.h>
+#include <Thermistor.h>
+#include <AdcScanner.h>
+#include <HeatEnergy.h>
 #include <HydroStoveDisplay.h>
+#include <RamMonitor.h>
+#include <EEPROM.h>
 #include <SPI.h>
 #include <Wire.h>
 #include <Adafruit_GFX.h>     //see https://github.com/adafruit/Adafruit-GFX-Library
@@ -43,7 +50,19 @@ Loop:
 //Define pin in/out
 #define PIN_SERIAL_RX     0                         //hardware
 #define PIN_SERIAL_TX     1                         //hardware
+//caudalímetro: por defecto una interrupción por pulso en INT0 (pin 2). Con
+//-D FLOW_HW_COUNTER el sensor va a T1 (pin 5) y cuenta el Timer1, sin
+//interrupciones por pulso. Con -D FLOW_CAPTURE va a ICP1 (pin 8) y el Timer1
+//mide el periodo entre pulsos: mejor resolución a caudal bajo y medidas cada
+//250 ms. Con -D FLOW_PIN_CHANGE cuenta la interrupción de cambio de pin, que
+//admite hasta 8 caudalímetros en cualquier pin (aquí el mismo pin 2)
+#if defined(FLOW_HW_COUNTER)
+#define PIN_FLOWMETER     FLOWMETER_COUNTER_PIN     //T1, entrada de reloj del Timer1
+#elif defined(FLOW_CAPTURE)
+#define PIN_FLOWMETER     FLOWMETER_CAPTURE_PIN     //ICP1, captura del Timer1
+#else
 #define PIN_FLOWMETER     2                         //External interrupt (2,3)
+#endif
 #define PIN_OLED_RESET    3                         //IO OUT   (for OLED)
 //#define PIN_I2C_SDA       4                         //hardware (for OLED)
 //#define PIN_I2C_SCL       5                         //hardware (for OLED)
@@ -57,12 +76,34 @@ Loop:
 //#define YPOS 1
 //#define DELTAY 2
 
-// set the measurement update period to 1s (1000 ms)
+// ventana de medida más larga del caudalímetro: 1 s contando pulsos; midiendo
+// periodos (FLOW_CAPTURE) basta con 250 ms, la medida sale de dos pulsos
+#ifdef FLOW_CAPTURE
+#define DELTA_FLOW    250
+#else
 #define DELTA_FLOW    1000
+#endif
+
+// ventana adaptativa: con caudal alto mide en cuanto tiene FLOW_GATE_PULSES pulsos
+// (precisión de cuantización 1/FLOW_GATE_PULSES), nunca antes de FLOW_GATE_MIN ms;
+// con caudal bajo espera hasta DELTA_FLOW
+#define FLOW_GATE_PULSES  100
+#define FLOW_GATE_MIN     100
+
+// caudal detenido: sin pulsos durante 4 periodos del caudal medido (mínimo 20 ms).
+// Lo vigila la interrupción de comparación del Timer0 cada 1,024 ms, no loop()
+#define FLOW_STOP_PERIODS 4
+#define FLOW_STOP_MIN_GAP 20000UL
 
 // refresca la pantala a 2fps
 #define DELTA_DISPLAY 500
 
+// informe de RAM libre por serie cada minuto (compilar con -D DEBUG_RAM)
+#define DELTA_RAM_REPORT 60000
+
+// informe de ocupación del bus I2C por serie cada minuto (compilar con -D DEBUG_BUS)
+#define DELTA_BUS_REPORT 60000
+
 #define SERIAL_RESISTOR_HOT   10000
 #define SERIAL_RESISTOR_COLD   10000
 #define THERMISTORNOMINAL    100000                // resistance at 25 degrees C
@@ -72,28 +113,112 @@ Loop:
 
 #define WARNING_TEMPERATURE   80
 
-SignalFilter outSensor, inSensor;
-int tempOut, tempIn;
-
-unsigned long currentTime, lastFlowMeter, lastDisplay, lastBuffered;
-volatile int adcAux;
+//aviso predictivo: pendiente de la temperatura de salida (mínimos cuadrados sobre
+//TREND_WINDOW muestras tomadas cada DELTA_TREND ms). Si la bomba se para, la salida
+//sube varios grados por minuto: se avisa cuando, a ese ritmo, se alcanzaría
+//WARNING_TEMPERATURE en menos de WARNING_LEAD_TIME segundos
+#define DELTA_TREND           2000
+#define TREND_WINDOW          30                    //1 minuto
+#define WARNING_LEAD_TIME     120
+
+//bits de los avisos
+#define WARNING_OVERHEAT      0x01                  //salida por encima de WARNING_TEMPERATURE
+#define WARNING_TREND         0x02                  //la alcanzará en menos de WARNING_LEAD_TIME
+#define WARNING_NO_FLOW       0x04                  //el caudal se ha parado tras haber circulado
+
+//energía acumulada: el total de por vida se guarda en EEPROM cada hora (solo
+//los bytes que cambian, EEPROM.put usa update), unas 9000 escrituras al año
+#define DELTA_ENERGY_SAVE     3600000UL
+#define EEPROM_ENERGY_ADDR    0
+#define EEPROM_ENERGY_MAGIC   0x4857                //"HW"
+
+//ventana de la mediana de las temperaturas (impar, 3..31). El ADC termina una
+//tanda cada 2 canales * 64 muestras / 976,6 Hz = 131 ms y loop(), sin esperas,
+//las recoge todas: 9 muestras cubren 1,2 s y descartan picos de hasta 4 tandas,
+//~0,5 s (motor del ventilador). Una pasada de loop() de más de 131 ms perdería
+//tandas y alargaría la ventana en proporción
+#define TEMP_MEDIAN_WINDOW    9
+
+//tablas de conversión ADC -> décimas de ºC, generadas al compilar
+typedef Thermistor<SERIAL_RESISTOR_HOT,  THERMISTORNOMINAL, BCOEFFICIENT, TEMPERATURENOMINAL> HotThermistor;
+typedef Thermistor<SERIAL_RESISTOR_COLD, THERMISTORNOMINAL, BCOEFFICIENT, TEMPERATURENOMINAL> ColdThermistor;
+
+//canales del muestreo en segundo plano (orden de AdcScanner::read)
+#define ADC_TEMP_OUT  0
+#define ADC_TEMP_IN   1
+#define ADC_CHANNELS  2
+static const uint8_t adcPins[ADC_CHANNELS] = {PIN_TEMP_OUT, PIN_TEMP_IN};
+
+MedianFilterBank<ADC_CHANNELS, TEMP_MEDIAN_WINDOW> tempFilters;   //un filtro por canal del ADC
+int adcValues[ADC_CHANNELS];                      //filtrados, 13 bits
+int tempOut, tempIn;                              //décimas de ºC
+SlopeEstimator<TREND_WINDOW> tempOutTrend;
+
+unsigned long currentTime, lastDisplay, lastBuffered, lastRamReport, lastBusReport, lastTrend, lastEnergySave;
 unsigned int l_hour; // Calculated litres/hour
 unsigned int scale = 1;
 bool led=false;
+bool flowSeen=false;                                //sin caudal solo es un aviso si antes lo hubo
+uint8_t warnings=0;                                 //avisos activos, un bit por condición (WARNING_*)
 
 
-HydroStoveDisplay display();
+HydroStoveDisplay display;
 //Adafruit_SSD1306 display;
 FlowSensorProperties MySensor = {60.0f, 4.5f, {1.2, 1.1, 1.05, 1, 1, 1, 1, 0.95, 0.9, 0.8}}; //see https://github.com/sekdiy/FlowMeter/wiki/Calibration
+#if defined(FLOW_HW_COUNTER)
+FlowMeterCounter Meter = FlowMeterCounter(MySensor);
+#elif defined(FLOW_CAPTURE)
+FlowMeterCapture Meter = FlowMeterCapture(MySensor);
+#elif defined(FLOW_PIN_CHANGE)
+FlowMeterPinChange Meter = FlowMeterPinChange(PIN_FLOWMETER, MySensor);
+#else
 FlowMeter Meter = FlowMeter(PIN_FLOWMETER, MySensor);
+#endif
+HeatEnergy energy;                                //Wh de esta sesión y de por vida
+
+//registro del total de por vida en EEPROM
+struct EnergyRecord {
+  uint16_t magic;
+  uint64_t lifetimeWh;
+};
 
 
+/*
+ * Recupera el total de energía de por vida (0 si la EEPROM no tiene registro).
+ */
+void loadEnergy(){
+  EnergyRecord record;
+  EEPROM.get(EEPROM_ENERGY_ADDR, record);
+  energy.setLifetimeWh(record.magic == EEPROM_ENERGY_MAGIC ? record.lifetimeWh : 0);
+}
+
+
+/*
+ * Guarda el total de energía de por vida.
+ */
+void saveEnergy(){
+  EnergyRecord record = {EEPROM_ENERGY_MAGIC, energy.lifetimeWh()};
+  EEPROM.put(EEPROM_ENERGY_ADDR, record);
+}
+
+
+#if !defined(FLOW_HW_COUNTER) && !defined(FLOW_CAPTURE) && !defined(FLOW_PIN_CHANGE)
 /*
  * Función llamada cada vez que el caudalímetro produce un pulso.
  */
 void flowISR (){ // Interrupt function
   Meter.count();
 }
+#endif
+
+
+/*
+ * Vigilancia del caudal. El Timer0 (millis) desborda cada 1,024 ms; la comparación
+ * A salta a mitad de cuenta con el mismo periodo (OCR0A solo lo usa el PWM del pin 6).
+ */
+ISR(TIMER0_COMPA_vect){
+  Meter.checkFlow();                                //TODO: play buzzer si devuelve true
+}
 
 
 void setup()   {
@@ -107,6 +232,9 @@ void setup()   {
 
 
   //Serial.begin(9600);
+#if defined(DEBUG_RAM) || defined(DEBUG_BUS)
+  Serial.begin(9600);
+#endif
 
   //Init pin
   pinMode(PIN_FLOWMETER, INPUT_PULLUP);
@@ -116,18 +244,24 @@ void setup()   {
   //pinMode(PIN_LED,       OUTPUT);
   pinMode(LED_BUILTIN, OUTPUT);
 
-  //Init temperature sensors filters
-  outSensor.begin();
-  outSensor.setFilter('m'); //bessel filter (b), median filter (m) or Chebyshev filter (c)
-  //outSensor.setOrder(2);
-  inSensor.begin();
-  inSensor.setFilter('m');
-  //inSensor.setOrder(2);
+  display.begin();                                  //pantalla, ya con init() hecho
+
+  loadEnergy();
 
+  //el ADC muestrea los termistores solo (64 muestras por canal, 13 bits)
+  AdcScanner::begin(adcPins, ADC_CHANNELS);
+
+#if defined(FLOW_HW_COUNTER) || defined(FLOW_CAPTURE) || defined(FLOW_PIN_CHANGE)
+  Meter.begin();                                    //el Timer1 o la interrupción de cambio de pin cuentan los pulsos
+#else
   attachInterrupt(0, flowISR, FALLING); // Setup Interrupt
-  lastFlowMeter  = millis();
+#endif
+  Meter.setGate(FLOW_GATE_PULSES, DELTA_FLOW, FLOW_GATE_MIN);
+  Meter.setStopDetection(FLOW_STOP_PERIODS, FLOW_STOP_MIN_GAP);
   // sometimes initializing the gear generates some pulses that we should ignore
   Meter.reset();
+  OCR0A = 0x80;
+  TIMSK0 |= _BV(OCIE0A);                            //vigilancia del caudal, ver TIMER0_COMPA_vect
   sei(); // Enable interrupts
 
   //show logo
@@ -138,99 +272,115 @@ void setup()   {
 }
 
 
+//sin esperas: cada tarea lleva su propio periodo con millis(), así la ventana
+//del caudalímetro se cierra en cuanto tiene los pulsos (FLOW_GATE_*)
 void loop() {
-  digitalWrite(LED_BUILTIN, led);
-  led=!led;
-
-  //Lee temperatura de salida
-  adcAux = analogRead(PIN_TEMP_OUT);
-  tempOut = adc2temp(outSensor.run(adcAux), SERIAL_RESISTOR_HOT);
-  //Serial.println("OUT: " + String(tempOut) + " ºC (" + String(adcAux) + ")");
-
-  //lee temperatura de entrada
-  adcAux = analogRead(PIN_TEMP_IN);
-  tempIn = adc2temp(inSensor.run(adcAux), SERIAL_RESISTOR_COLD);
-  //Serial.println("IN: " + String(tempIn) + " ºC (" + String(adcAux) + ")");
+  //lee las temperaturas si el ADC ha terminado una nueva tanda (13 bits)
+  if (AdcScanner::available()){
+    for (uint8_t i=0; i<ADC_CHANNELS; i++){
+      adcValues[i] = AdcScanner::read(i);
+    }
+    tempFilters.run(adcValues, adcValues);
+    //13 -> 16 bits sin signo: en int, 8191 << 3 desbordaría
+    tempOut = HotThermistor::toDeciCelsius((unsigned int)adcValues[ADC_TEMP_OUT] << 3);
+    tempIn  = ColdThermistor::toDeciCelsius((unsigned int)adcValues[ADC_TEMP_IN] << 3);
+    //Serial.println("OUT: " + String(tempOut) + ", IN: " + String(tempIn) + " (décimas de ºC)");
+  }
 
   //lee caudalímetro
-  if (millis() - lastFlowMeter >= DELTA_FLOW){
-    Meter.tick(millis() - lastFlowMeter);
-    lastFlowMeter = millis();
+  if (Meter.update(millis())){
+    if (Meter.getCurrentFlowUlps() > 0){
+      flowSeen = true;
+    }
+    //integra la potencia (trapecios) con el tiempo exacto entre medidas
+    energy.add(heatPowerW(tempIn, tempOut, Meter.getCurrentFlowMlps()), millis());
+    display.setEnergy(energy.sessionWh());
     // output some measurement result
     //Serial.println("FLOW: " + String(Meter.getCurrentFlowrate()) + " l/min, " + String(Meter.getTotalVolume())+ " l total.");
   }
 
-  /*//valora los avisos
-  if (!display.getWarning() &&
-      ( tempOut >= WARNING_TEMPERATURE || Meter.getCurrentFlowrate() == 0) ){
-    display.setWarning(true);
+  if (millis() - lastEnergySave >= DELTA_ENERGY_SAVE){
+    saveEnergy();
+    lastEnergySave = millis();
+  }
+
+  //el pulsador enciende la pantalla si se había apagado por inactividad
+  if (digitalRead(PIN_BUTTON_1) == LOW){
+    display.wake();
+  }
+
+  //tendencia de la temperatura de salida
+  if (millis() - lastTrend >= DELTA_TREND){
+    tempOutTrend.add(tempOut);
+    lastTrend = millis();
+  }
+
+  //valora los avisos: siguen activos mientras se cumpla su condición y se
+  //apagan solos. Cada aviso nuevo vuelve a encender la pantalla
+  uint8_t active = 0;
+  if (tempOut >= WARNING_TEMPERATURE*10){
+    active |= WARNING_OVERHEAT;
+  }
+  if (tempOutTrend.samplesTo(WARNING_TEMPERATURE*10) <= WARNING_LEAD_TIME*1000UL/DELTA_TREND){
+    active |= WARNING_TREND;
+  }
+  if (Meter.isFlowStopped() ||                      //al instante, sin esperar a la ventana de medida
+      (flowSeen && Meter.getCurrentFlowMlps() == 0)){
+    active |= WARNING_NO_FLOW;
+  }
+  if (active & ~warnings){
+    display.wake();
     //TODO: play buzzer
   }
+  warnings = active;
+  display.setWarning(warnings != 0);
 
   //añade un nuevo valor al gráfico si procede
   if (millis() - lastBuffered >= DELTA_DISPLAY*scale){
-    scale = display.add(tempIn, tempOut, Meter.getCurrentFlowrate());
+    scale = display.add(tempIn, tempOut, Meter.getCurrentFlowMlps(), energy.takeMeanPowerW());
+    lastBuffered = millis();
   }
 
-  //refresca la pantalla
+  //refresca la pantalla. Solo repinta si algo ha cambiado (ver setRefreshThresholds)
   //TODO: si hay warnings, al ternar gráfica con icono grande de warning!!!
   if (millis() - lastDisplay >= DELTA_DISPLAY){
     display.refreshDisplay();
     lastDisplay = millis();
-  }*/
-
-  delay(1000);
-}
-
-
-
-
+    digitalWrite(LED_BUILTIN, led);                 //latido
+    led=!led;
+  }
 
-/*
- * Transforma los valores ADC a ºC. Se asume que los dos
- * termistores son iguales (misma B).
- * Parámetros:
- * adc: valor obtenido con analogRead()
- * sr: resistencia en serie con el termistor para hacer el
- *     divisor de tensión.
- */
-double adc2temp(int adc, int sr){
-  //convert ADC value to resistance
-  adc = 1023 / adc - 1;
-  adc = sr / adc;
-
-  double steinhart;
-  steinhart = adc / THERMISTORNOMINAL;                  // (R/Ro)
-  steinhart = log(steinhart);                           // ln(R/Ro)
-  steinhart /= BCOEFFICIENT;                            // 1/B * ln(R/Ro)
-  steinhart += 1.0 / (TEMPERATURENOMINAL + 273.15);     // + (1/To)
-  steinhart = 1.0 / steinhart;                          // Invert
-  steinhart -= 273.15;                                  // convert to C
-
-  return steinhart;
+#ifdef DEBUG_BUS
+  //comparar con setRefreshThresholds(0, 0, 0), que repinta siempre
+  if (millis() - lastBusReport >= DELTA_BUS_REPORT){
+    uint16_t load = display.busLoad();
+
+    Serial.print(F("I2C ocupado: "));
+    Serial.print(load / 10);
+    Serial.print('.');
+    Serial.print(load % 10);
+    Serial.println(F(" %"));
+    lastBusReport = millis();
+  }
+#endif
+
+#ifdef DEBUG_RAM
+  //la marca de agua no debe bajar con los días si nada usa el heap
+  if (millis() - lastRamReport >= DELTA_RAM_REPORT){
+    Serial.print(F("RAM libre: "));
+    Serial.print(ramFree());
+    Serial.print(F(" B, minimo: "));
+    Serial.print(ramHighWaterFree());
+    Serial.print(F(" B, heap: "));
+    Serial.print(ramHeapUsed());
+    Serial.println(F(" B"));
+    lastRamReport = millis();
+  }
+#endif
 }
 
 
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
 
 
 /*
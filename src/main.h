@@ -1 +0,0 @@
-double adc2temp(int adc, int sr);